@@ -0,0 +1,149 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chord.h"
+
+// Microbenchmark du choix du prochain saut : temps par appel de find_next sur les finger tables d'un
+// anneau de N pairs, pour des clés tirées au hasard. Il est comparé à l'ancien noyau, qui retenait le
+// finger d'id le plus grand avec des branchements, et chaque choix est vérifié par une recherche directe,
+// sur la finger table exacte puis sur une copie perturbée
+// A compiler pour chaque taille d'identifiants, avec ou sans -mavx2
+
+// Ancien find_next de ex1, conservé pour la comparaison
+static int find_next_ancien(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    int rank = -1;
+    for (int i = 0; i < M; i++) {
+        int plus_grand = rank == -1 || cle_cmp(finger_table[i], finger_table[rank]) > 0;
+        if (cle_cmp(finger_table[i], id_p) < 0) {
+            if (cle_cmp(finger_table[i], key) < 0 && cle_cmp(key, id_p) <= 0 && plus_grand) {
+                rank = i;
+            }
+        } else if (cle_cmp(finger_table[i], id_p) > 0) {
+            if ((cle_cmp(finger_table[i], key) < 0 || cle_cmp(key, id_p) <= 0) && plus_grand) {
+                rank = i;
+            }
+        }
+    }
+    return rank;
+}
+
+// Finger de ]id_p, key[ le plus proche de la clé, par la définition
+static int precedent_direct(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    int rank = -1;
+    for (int i = 0; i < M; i++) {
+        if (cle_egal(finger_table[i], key) || !cle_dans_intervalle(finger_table[i], id_p, key)) continue;
+        if (rank == -1 || cle_dans_intervalle(finger_table[i], finger_table[rank], key)) rank = i;
+    }
+    return rank;
+}
+
+// Copie perturbée d'une finger table, comme celles des pairs de ex1 pendant les joins et les pannes :
+// un quart des entrées remplacées par des pairs au hasard, puis l'ordre mélangé. Le plus proche précédent
+// n'est alors plus forcément le dernier finger candidat
+static void perturber(const cle_t *finger_table, const cle_t *ids, int nb_pairs, cle_t *copie) {
+    for (int i = 0; i < M; i++) {
+        copie[i] = rand() % 4 == 0 ? ids[rand() % nb_pairs] : finger_table[i];
+    }
+    for (int i = M - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        cle_t f = copie[i];
+        copie[i] = copie[j];
+        copie[j] = f;
+    }
+}
+
+// 1 si find_next ne retient pas le même finger que la recherche directe
+static int verifier(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    int attendu = precedent_direct(id_p, finger_table, key);
+    int choisi = find_next(id_p, finger_table, key);
+    return attendu == -1 ? choisi != -1 : choisi == -1 || !cle_egal(finger_table[choisi], finger_table[attendu]);
+}
+
+static double horloge(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+typedef int (*Noyau)(cle_t, const cle_t *, cle_t);
+
+// Temps moyen d'un appel en ns, sur nb_tours passages des requêtes
+static double mesurer(Noyau noyau, const cle_t *ids, const cle_t *fingers, const int *pairs, const cle_t *keys,
+                      int nb_requetes, int nb_tours, long long *somme) {
+    double debut = horloge();
+    for (int t = 0; t < nb_tours; t++) {
+        for (int q = 0; q < nb_requetes; q++) {
+            int p = pairs[q];
+            *somme += noyau(ids[p], fingers + (size_t)p * M, keys[q]);
+        }
+    }
+    return 1e9 * (horloge() - debut) / ((double)nb_tours * nb_requetes);
+}
+
+int main(int argc, char **argv) {
+    // Options : -n nombre de pairs, -q nombre de requêtes, -t nombre de passages, -s graine
+    int nb_pairs = 100000;
+    int nb_requetes = 1000000;
+    int nb_tours = 5;
+    unsigned graine = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:q:t:s:")) != -1) {
+        switch (opt) {
+            case 'n': nb_pairs = atoi(optarg); break;
+            case 'q': nb_requetes = atoi(optarg); break;
+            case 't': nb_tours = atoi(optarg); break;
+            case 's': graine = (unsigned)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n nb_pairs] [-q nb_requetes] [-t nb_tours] [-s graine]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (nb_pairs < 1 || nb_requetes < 1 || nb_tours < 1 || (double)nb_pairs > ldexp(1, M)) {
+        fprintf(stderr, "Erreur: paramètres invalides\n");
+        return 1;
+    }
+
+    srand(graine);
+    cle_t *ids = (cle_t *)malloc(nb_pairs * sizeof(cle_t));
+    cle_t *ids_tries = (cle_t *)malloc(nb_pairs * sizeof(cle_t));
+    int *rangs_tries = (int *)malloc(nb_pairs * sizeof(int));
+    cle_t *fingers = (cle_t *)fingers_allouer((size_t)nb_pairs * M * sizeof(cle_t));
+    generer_identifiants(ids, nb_pairs, ids_tries, rangs_tries);
+    calculer_finger_tables(ids_tries, rangs_tries, nb_pairs, fingers, NULL);
+
+    int *pairs = (int *)malloc(nb_requetes * sizeof(int));
+    cle_t *keys = (cle_t *)malloc(nb_requetes * sizeof(cle_t));
+    long long erreurs = 0, erreurs_perturbees = 0;
+    cle_t perturbee[M];
+    for (int q = 0; q < nb_requetes; q++) {
+        int valeur = rand();
+        pairs[q] = rand() % nb_pairs;
+        keys[q] = hash_cle(&valeur, sizeof(valeur));
+        const cle_t *finger_table = fingers + (size_t)pairs[q] * M;
+        erreurs += verifier(ids[pairs[q]], finger_table, keys[q]);
+        perturber(finger_table, ids, nb_pairs, perturbee);
+        erreurs_perturbees += verifier(ids[pairs[q]], perturbee, keys[q]);
+    }
+
+    long long somme = 0;
+    double ns_ancien = mesurer(find_next_ancien, ids, fingers, pairs, keys, nb_requetes, nb_tours, &somme);
+    double ns = mesurer(find_next, ids, fingers, pairs, keys, nb_requetes, nb_tours, &somme);
+#if M >= 8 && defined(__AVX2__)
+    const char *noyau = "AVX2";
+#else
+    const char *noyau = "scalaire";
+#endif
+    printf("M = %d, %d pairs, %d requêtes : find_next (%s) %.2f ns par choix, ancien noyau %.2f ns (x%.2f), %lld erreurs, %lld sur tables perturbées [%lld]\n",
+           M, nb_pairs, nb_requetes, noyau, ns, ns_ancien, ns_ancien / ns, erreurs, erreurs_perturbees, somme % 10);
+
+    free(ids);
+    free(ids_tries);
+    free(rangs_tries);
+    free(fingers);
+    free(pairs);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chord.h"
+
+// Cache des responsables de clés d'un rang
+// Chaque case retient un intervalle ]debut, fin] de l'anneau et le numéro du pair qui en est
+// responsable. Le cache est à correspondance directe : la case d'une clé est donnée par ses bits de
+// poids fort, les clés proches partagent donc la même case et un intervalle appris sert à toutes
+// celles qu'il contient. Une insertion remplace le contenu de la case
+// Les cases sont protégées par des verrous répartis, les compteurs sont atomiques
+
+typedef struct {
+    cle_t debut;
+    cle_t fin;
+    int numero;         // 0 pour une case vide
+} EntreeCache;
+
+typedef struct {
+    EntreeCache *entrees;
+    int taille;         // Nombre de cases, puissance de 2, 0 si le cache est désactivé
+    int bits;
+    pthread_mutex_t *verrous;
+    int nb_verrous;     // Puissance de 2
+    long long consultations;
+    long long succes;
+    long long perimees; // Succès dont le pair n'était plus responsable
+    long long insertions;
+} Cache;
+
+// taille est arrondie à la puissance de 2 inférieure
+static inline void cache_init(Cache *c, int taille, int nb_verrous) {
+    memset(c, 0, sizeof(Cache));
+    if (taille <= 0) return;
+    while (c->bits < 30 && (2 << c->bits) <= taille) c->bits++;
+    if (c->bits > M) c->bits = M;
+    c->taille = 1 << c->bits;
+    c->entrees = (EntreeCache *)calloc(c->taille, sizeof(EntreeCache));
+    c->nb_verrous = nb_verrous;
+    c->verrous = (pthread_mutex_t *)malloc(nb_verrous * sizeof(pthread_mutex_t));
+    for (int k = 0; k < nb_verrous; k++) {
+        pthread_mutex_init(&c->verrous[k], NULL);
+    }
+}
+
+static inline void cache_liberer(Cache *c) {
+    for (int k = 0; k < c->nb_verrous; k++) {
+        pthread_mutex_destroy(&c->verrous[k]);
+    }
+    free(c->verrous);
+    free(c->entrees);
+    memset(c, 0, sizeof(Cache));
+}
+
+static inline int cache_case(const Cache *c, cle_t key) {
+    return (int)cle_poids_fort(key, c->bits);
+}
+
+// Numéro du pair responsable de la clé d'après le cache, 0 s'il n'est pas connu
+static inline int cache_chercher(Cache *c, cle_t key) {
+    if (c->taille == 0) return 0;
+    int i = cache_case(c, key);
+    pthread_mutex_t *verrou = &c->verrous[i & (c->nb_verrous - 1)];
+    pthread_mutex_lock(verrou);
+    EntreeCache e = c->entrees[i];
+    pthread_mutex_unlock(verrou);
+
+    __atomic_add_fetch(&c->consultations, 1, __ATOMIC_RELAXED);
+    if (e.numero == 0 || !cle_dans_intervalle(key, e.debut, e.fin)) return 0;
+    __atomic_add_fetch(&c->succes, 1, __ATOMIC_RELAXED);
+    return e.numero;
+}
+
+// Retient que le pair numero est responsable de ]debut, fin], qui contient la clé résolue key
+static inline void cache_ajouter(Cache *c, cle_t key, cle_t debut, cle_t fin, int numero) {
+    if (c->taille == 0) return;
+    int i = cache_case(c, key);
+    pthread_mutex_t *verrou = &c->verrous[i & (c->nb_verrous - 1)];
+    pthread_mutex_lock(verrou);
+    c->entrees[i].debut = debut;
+    c->entrees[i].fin = fin;
+    c->entrees[i].numero = numero;
+    pthread_mutex_unlock(verrou);
+    __atomic_add_fetch(&c->insertions, 1, __ATOMIC_RELAXED);
+}
+
+// Le pair numero n'est plus responsable de la clé : la case qui le désignait est vidée
+static inline void cache_invalider(Cache *c, cle_t key, int numero) {
+    if (c->taille == 0) return;
+    int i = cache_case(c, key);
+    pthread_mutex_t *verrou = &c->verrous[i & (c->nb_verrous - 1)];
+    pthread_mutex_lock(verrou);
+    if (c->entrees[i].numero == numero) c->entrees[i].numero = 0;
+    pthread_mutex_unlock(verrou);
+    __atomic_add_fetch(&c->perimees, 1, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,568 @@
+#ifndef CHORD_H
+#define CHORD_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Nombre de bits pour les identifiants, modifiable à la compilation (-DM=64, -DM=160)
+#ifndef M
+#define M 5
+#endif
+
+#if M < 1 || M > 160
+#error "M doit être compris entre 1 et 160"
+#endif
+
+// Taille max de la représentation textuelle d'un identifiant
+#define CLE_STR 48
+
+/********** IDENTIFIANTS **********/
+
+#if M <= 64
+
+// Jusqu'à 64 bits l'identifiant tient dans un entier non signé
+typedef uint64_t cle_t;
+
+#if M == 64
+#define CLE_MASQUE UINT64_MAX
+#else
+#define CLE_MASQUE ((UINT64_C(1) << M) - 1)
+#endif
+
+static inline cle_t cle_depuis_u64(uint64_t v) {
+    return v & CLE_MASQUE;
+}
+
+static inline int cle_cmp(cle_t a, cle_t b) {
+    return (a > b) - (a < b);
+}
+
+// (a + 2^i) mod 2^M
+static inline cle_t cle_ajoute_puissance2(cle_t a, int i) {
+    return (a + (UINT64_C(1) << i)) & CLE_MASQUE;
+}
+
+// Distance dans le sens horaire de a vers b : (b - a) mod 2^M
+static inline cle_t cle_distance(cle_t a, cle_t b) {
+    return (b - a) & CLE_MASQUE;
+}
+
+// 32 bits de poids faible
+static inline uint32_t cle_poids_faible(cle_t a) {
+    return (uint32_t)a;
+}
+
+// Fraction de l'anneau que représente la distance d
+static inline double cle_fraction(cle_t d) {
+    return ldexp((double)d, -M);
+}
+
+// Les bits bits de poids fort de l'identifiant, bits <= M et bits <= 32
+static inline uint32_t cle_poids_fort(cle_t a, int bits) {
+    return bits == 0 ? 0 : (uint32_t)(a >> (M - bits));
+}
+
+static inline const char *cle_str(cle_t a, char *buf) {
+    snprintf(buf, CLE_STR, "%llu", (unsigned long long)a);
+    return buf;
+}
+
+#else
+
+// Au delà de 64 bits l'identifiant est un tableau de mots de 32 bits, w[0] est le poids fort
+#define CLE_MOTS ((M + 31) / 32)
+#define CLE_BITS_HAUTS (M - 32 * (CLE_MOTS - 1))
+
+typedef struct {
+    uint32_t w[CLE_MOTS];
+} cle_t;
+
+static inline cle_t cle_masquer(cle_t a) {
+#if CLE_BITS_HAUTS < 32
+    a.w[0] &= (UINT32_C(1) << CLE_BITS_HAUTS) - 1;
+#endif
+    return a;
+}
+
+static inline cle_t cle_depuis_u64(uint64_t v) {
+    cle_t a;
+    memset(&a, 0, sizeof(a));
+    a.w[CLE_MOTS - 1] = (uint32_t)v;
+    a.w[CLE_MOTS - 2] = (uint32_t)(v >> 32);
+    return cle_masquer(a);
+}
+
+static inline int cle_cmp(cle_t a, cle_t b) {
+    for (int i = 0; i < CLE_MOTS; i++) {
+        if (a.w[i] != b.w[i]) {
+            return a.w[i] > b.w[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+// (a + 2^i) mod 2^M, propagation de la retenue vers les poids forts
+static inline cle_t cle_ajoute_puissance2(cle_t a, int i) {
+    int mot = CLE_MOTS - 1 - i / 32;
+    uint64_t somme = (uint64_t)a.w[mot] + (UINT64_C(1) << (i % 32));
+    a.w[mot] = (uint32_t)somme;
+    for (mot--; mot >= 0 && (somme >> 32); mot--) {
+        somme = (uint64_t)a.w[mot] + 1;
+        a.w[mot] = (uint32_t)somme;
+    }
+    return cle_masquer(a);
+}
+
+// Distance dans le sens horaire de a vers b : (b - a) mod 2^M
+static inline cle_t cle_distance(cle_t a, cle_t b) {
+    cle_t d;
+    int64_t emprunt = 0;
+    for (int i = CLE_MOTS - 1; i >= 0; i--) {
+        int64_t diff = (int64_t)b.w[i] - a.w[i] - emprunt;
+        emprunt = diff < 0;
+        d.w[i] = (uint32_t)diff;
+    }
+    return cle_masquer(d);
+}
+
+static inline uint32_t cle_poids_faible(cle_t a) {
+    return a.w[CLE_MOTS - 1];
+}
+
+// Le mot de poids fort n'a que CLE_BITS_HAUTS bits, les 32 suivants complètent toujours bits <= 32
+static inline uint32_t cle_poids_fort(cle_t a, int bits) {
+    uint64_t haut = ((uint64_t)a.w[0] << 32) | a.w[1];
+    return bits == 0 ? 0 : (uint32_t)(haut >> (CLE_BITS_HAUTS + 32 - bits));
+}
+
+static inline double cle_fraction(cle_t d) {
+    double f = 0;
+    for (int i = 0; i < CLE_MOTS; i++) {
+        f += ldexp((double)d.w[i], 32 * (CLE_MOTS - 1 - i) - M);
+    }
+    return f;
+}
+
+static inline const char *cle_str(cle_t a, char *buf) {
+    int pos = 0;
+    for (int i = 0; i < CLE_MOTS; i++) {
+        pos += snprintf(buf + pos, CLE_STR - pos, "%08x", a.w[i]);
+    }
+    return buf;
+}
+
+#endif
+
+static inline int cle_egal(cle_t a, cle_t b) {
+    return cle_cmp(a, b) == 0;
+}
+
+// Vérifie si x appartient à l'intervalle ]a, b] de l'anneau
+// Si a == b l'intervalle couvre tout l'anneau
+static inline int cle_dans_intervalle(cle_t x, cle_t a, cle_t b) {
+    cle_t dx = cle_distance(a, x);
+    cle_t db = cle_distance(a, b);
+    if (cle_egal(a, b)) return 1;
+    return cle_cmp(dx, cle_depuis_u64(0)) > 0 && cle_cmp(dx, db) <= 0;
+}
+
+/********** HACHAGE **********/
+
+// Mélange 128 bits de type wyhash
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+// Hachage rapide non cryptographique d'une suite d'octets quelconque
+static inline uint64_t hash64(const void *donnees, size_t taille, uint64_t graine) {
+    const uint64_t s0 = UINT64_C(0xa0761d6478bd642f);
+    const uint64_t s1 = UINT64_C(0xe7037ed1a0b428db);
+    const uint64_t s2 = UINT64_C(0x8ebc6af09c88c6e3);
+    const uint8_t *p = (const uint8_t *)donnees;
+    size_t reste = taille;
+
+    uint64_t h = graine ^ hash_mix(graine ^ s0, s1);
+    while (reste >= 16) {
+        uint64_t a, b;
+        memcpy(&a, p, 8);
+        memcpy(&b, p + 8, 8);
+        h = hash_mix(a ^ s1, b ^ h);
+        p += 16;
+        reste -= 16;
+    }
+
+    uint64_t a = 0, b = 0;
+    if (reste > 8) {
+        memcpy(&a, p, 8);
+        memcpy(&b, p + 8, reste - 8);
+    } else {
+        memcpy(&a, p, reste);
+    }
+    h = hash_mix(a ^ s1, b ^ h ^ s2);
+    return hash_mix(h ^ s0, (uint64_t)taille ^ s1);
+}
+
+// Place une clé quelconque sur l'anneau
+static inline cle_t hash_cle(const void *donnees, size_t taille) {
+#if M <= 64
+    return cle_depuis_u64(hash64(donnees, taille, 0));
+#else
+    cle_t a;
+    for (int i = 0; i < CLE_MOTS; i += 2) {
+        uint64_t h = hash64(donnees, taille, i);
+        a.w[i] = (uint32_t)(h >> 32);
+        if (i + 1 < CLE_MOTS) a.w[i + 1] = (uint32_t)h;
+    }
+    return cle_masquer(a);
+#endif
+}
+
+/********** FINGER TABLES **********/
+
+// Identifiant d'un pair associé à son rang MPI
+typedef struct {
+    cle_t id;
+    int rang;
+} PairRang;
+
+static inline int pair_rang_cmp(const void *a, const void *b) {
+    return cle_cmp(((const PairRang *)a)->id, ((const PairRang *)b)->id);
+}
+
+// Trie les identifiants, le pair identifiers[j] étant au rang j+1
+// ids_tries et rangs_tries sont deux tableaux parallèles
+static inline void trier_identifiants(const cle_t *identifiers, int num_pairs, cle_t *ids_tries, int *rangs_tries) {
+    PairRang *tri = (PairRang *)malloc(num_pairs * sizeof(PairRang));
+    for (int j = 0; j < num_pairs; j++) {
+        tri[j].id = identifiers[j];
+        tri[j].rang = j+1;
+    }
+    qsort(tri, num_pairs, sizeof(PairRang), pair_rang_cmp);
+    for (int j = 0; j < num_pairs; j++) {
+        ids_tries[j] = tri[j].id;
+        rangs_tries[j] = tri[j].rang;
+    }
+    free(tri);
+}
+
+// Tire au hasard les identifiants de num_pairs pairs, sans doublon
+// Les doublons sont détectés après le tri et tirés à nouveau
+static inline void generer_identifiants(cle_t *identifiers, int num_pairs, cle_t *ids_tries, int *rangs_tries) {
+    for (int j = 0; j < num_pairs; j++) {
+        int valeur = rand();
+        identifiers[j] = hash_cle(&valeur, sizeof(valeur));
+    }
+    int doublon = 1;
+    while (doublon) {
+        doublon = 0;
+        trier_identifiants(identifiers, num_pairs, ids_tries, rangs_tries);
+        for (int j = 1; j < num_pairs; j++) {
+            if (cle_egal(ids_tries[j], ids_tries[j-1])) {
+                int valeur = rand();
+                identifiers[rangs_tries[j]-1] = hash_cle(&valeur, sizeof(valeur));
+                doublon = 1;
+            }
+        }
+    }
+}
+
+// Indice dans ids_tries du successeur de x : le premier identifiant >= x, sinon le plus petit
+static inline int successeur_trie(const cle_t *ids_tries, int num_pairs, cle_t x) {
+    int debut = 0, fin = num_pairs;
+    while (debut < fin) {
+        int milieu = (debut + fin) / 2;
+        if (cle_cmp(ids_tries[milieu], x) < 0) {
+            debut = milieu + 1;
+        } else {
+            fin = milieu;
+        }
+    }
+    return debut == num_pairs ? 0 : debut;
+}
+
+// Calcul de la finger table d'un pair par recherche dichotomique, en O(M * log N)
+// finger_table_rank peut être NULL si les rangs ne sont pas nécessaires
+static inline void calculate_finger_table(cle_t id_p, const cle_t *ids_tries, const int *rangs_tries, int num_pairs,
+                                   cle_t *finger_table, int *finger_table_rank) {
+    for (int i = 0; i < M; i++) {
+        int j = successeur_trie(ids_tries, num_pairs, cle_ajoute_puissance2(id_p, i));
+        finger_table[i] = ids_tries[j];
+        if (finger_table_rank != NULL) {
+            finger_table_rank[i] = rangs_tries[j];
+        }
+    }
+}
+
+// Calcul des finger tables de tous les pairs, en O(N * M) après le tri
+// Pour une entrée i donnée les cibles id + 2^i sont croissantes le long de l'anneau trié,
+// leur successeur ne fait donc qu'avancer et un seul balayage suffit
+// La table du pair de rang r est rangée en finger_tables + (r-1)*M
+static inline void calculer_finger_tables(const cle_t *ids_tries, const int *rangs_tries, int num_pairs,
+                                   cle_t *finger_tables, int *finger_tables_rank) {
+    for (int i = 0; i < M; i++) {
+        int s = successeur_trie(ids_tries, num_pairs, cle_ajoute_puissance2(ids_tries[0], i));
+        for (int j = 0; j < num_pairs; j++) {
+            cle_t cible = cle_ajoute_puissance2(ids_tries[j], i);
+            // Avance tant que la cible n'est pas dans ]pred(s), s]
+            while (!cle_dans_intervalle(cible, ids_tries[(s - 1 + num_pairs) % num_pairs], ids_tries[s])) {
+                s = (s + 1) % num_pairs;
+            }
+            int r = rangs_tries[j];
+            finger_tables[(r-1)*M + i] = ids_tries[s];
+            if (finger_tables_rank != NULL) {
+                finger_tables_rank[(r-1)*M + i] = rangs_tries[s];
+            }
+        }
+    }
+}
+
+/********** ROUTAGE **********/
+
+// Les finger tables sont allouées alignées sur FINGERS_ALIGNEMENT octets, pour les chargements vectoriels
+// de find_next ; la taille est arrondie à un multiple de l'alignement
+#define FINGERS_ALIGNEMENT 32
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+static inline void *fingers_allouer(size_t taille) {
+    taille = (taille + FINGERS_ALIGNEMENT - 1) / FINGERS_ALIGNEMENT * FINGERS_ALIGNEMENT;
+    return aligned_alloc(FINGERS_ALIGNEMENT, taille);
+}
+
+// Trouve le finger qui précède la clé au plus près : le plus éloigné de id_p dans le sens horaire parmi
+// ceux de ]id_p, key[, -1 si aucun ne convient (le successeur est alors responsable de la clé)
+// Les distances de tous les fingers sont calculées d'un bloc et la sélection se fait sans branchement :
+// d est candidat si 0 < d < distance(id_p, key), ce qui s'écrit d - 1 < distance - 1 en non signé
+// (tout l'anneau si key == id_p). Avec AVX2 et 8 <= M <= 64, quatre fingers sont traités à la fois ; au
+// delà de 64 bits, huit fingers à la fois, mot par mot
+#if M >= 8 && M <= 64 && defined(__AVX2__)
+
+static inline int find_next(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    // Les comparaisons de AVX2 sont signées : les deux opérandes sont décalées du bit de signe
+    const __m256i signe = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i masque = _mm256_set1_epi64x((long long)CLE_MASQUE);
+    const __m256i un = _mm256_set1_epi64x(1);
+    const __m256i quatre = _mm256_set1_epi64x(4);
+    const __m256i id = _mm256_set1_epi64x((long long)id_p);
+    const __m256i borne = _mm256_set1_epi64x((long long)((cle_distance(id_p, key) - 1) ^ (UINT64_C(1) << 63)));
+    __m256i meilleur = _mm256_setzero_si256();
+    __m256i rangs = _mm256_set1_epi64x(-1);
+    __m256i i_vec = _mm256_setr_epi64x(0, 1, 2, 3);
+
+    int i = 0;
+    for (; i + 4 <= M; i += 4) {
+        __m256i d = _mm256_and_si256(_mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(finger_table + i)), id), masque);
+        __m256i candidat = _mm256_cmpgt_epi64(borne, _mm256_xor_si256(_mm256_sub_epi64(d, un), signe));
+        d = _mm256_and_si256(d, candidat);
+        __m256i plus = _mm256_cmpgt_epi64(_mm256_xor_si256(d, signe), _mm256_xor_si256(meilleur, signe));
+        meilleur = _mm256_blendv_epi8(meilleur, d, plus);
+        rangs = _mm256_blendv_epi8(rangs, i_vec, plus);
+        i_vec = _mm256_add_epi64(i_vec, quatre);
+    }
+
+    // Réduction des quatre voies puis fingers restants
+    uint64_t d_voies[4];
+    int64_t rangs_voies[4];
+    _mm256_storeu_si256((__m256i *)d_voies, meilleur);
+    _mm256_storeu_si256((__m256i *)rangs_voies, rangs);
+    uint64_t max = 0, borne_s = cle_distance(id_p, key) - 1;
+    int rank = -1;
+    for (int v = 0; v < 4; v++) {
+        int plus = d_voies[v] > max;
+        max = plus ? d_voies[v] : max;
+        rank = plus ? (int)rangs_voies[v] : rank;
+    }
+    for (; i < M; i++) {
+        uint64_t d = cle_distance(id_p, finger_table[i]);
+        d = d - 1 < borne_s ? d : 0;
+        int plus = d > max;
+        max = plus ? d : max;
+        rank = plus ? i : rank;
+    }
+    return rank;
+}
+
+#elif M <= 64
+
+static inline int find_next(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    uint64_t borne = cle_distance(id_p, key) - 1;
+    uint64_t max = 0;
+    int rank = -1;
+    for (int i = 0; i < M; i++) {
+        uint64_t d = cle_distance(id_p, finger_table[i]);
+        d = d - 1 < borne ? d : 0;
+        int plus = d > max;
+        max = plus ? d : max;
+        rank = plus ? i : rank;
+    }
+    return rank;
+}
+
+#else
+
+// Au delà de 64 bits, le mot de poids fort et les mots suivants (128 bits au plus) sont traités comme deux
+// entiers natifs : la distance est une soustraction avec retenue, la comparaison une paire de tests
+typedef unsigned __int128 cle_bas_t;
+
+static inline cle_bas_t cle_bas(const cle_t *a) {
+    cle_bas_t bas = 0;
+    for (int k = 1; k < CLE_MOTS; k++) {
+        bas = (bas << 32) | a->w[k];
+    }
+    return bas;
+}
+
+// Poursuit la recherche à partir du finger debut, rank étant le meilleur des précédents
+// Les parties basses des distances ne sont pas réduites modulo 2^(32 * (CLE_MOTS - 1)) : un emprunt les
+// décale toutes de la même quantité, ce qui garde leur ordre, pourvu que celle de rank soit calculée de même
+static inline int find_next_depuis(cle_t id_p, const cle_t *finger_table, cle_t key, int debut, int rank) {
+    const uint32_t masque_haut = (uint32_t)((UINT64_C(1) << CLE_BITS_HAUTS) - 1);
+    cle_bas_t id_bas = cle_bas(&id_p);
+    cle_bas_t borne_bas = cle_bas(&key) - id_bas;
+    uint32_t borne_haut = (key.w[0] - id_p.w[0] - (cle_bas(&key) < id_bas)) & masque_haut;
+    int tout = borne_haut == 0 && borne_bas == 0;
+    uint32_t max_haut = 0;
+    cle_bas_t max_bas = 0;
+    if (rank >= 0) {
+        cle_bas_t f_bas = cle_bas(&finger_table[rank]);
+        max_bas = f_bas - id_bas;
+        max_haut = (finger_table[rank].w[0] - id_p.w[0] - (f_bas < id_bas)) & masque_haut;
+    }
+    for (int i = debut; i < M; i++) {
+        cle_bas_t f_bas = cle_bas(&finger_table[i]);
+        cle_bas_t d_bas = f_bas - id_bas;
+        uint32_t d_haut = (finger_table[i].w[0] - id_p.w[0] - (f_bas < id_bas)) & masque_haut;
+        int dans_borne = tout | (d_haut < borne_haut) | ((d_haut == borne_haut) & (d_bas < borne_bas));
+        int plus = dans_borne & ((d_haut > max_haut) | ((d_haut == max_haut) & (d_bas > max_bas)));
+        max_haut = plus ? d_haut : max_haut;
+        max_bas = plus ? d_bas : max_bas;
+        rank = plus ? i : rank;
+    }
+    return rank;
+}
+
+#ifdef __AVX2__
+
+// Chaque voie porte un finger, dont les CLE_MOTS mots sont rassemblés dans CLE_MOTS registres : les
+// soustractions propagent l'emprunt d'un registre au suivant, et les comparaisons sur M bits combinent
+// celles des mots, du poids faible vers le poids fort. Les comparaisons de AVX2 sont signées, les mots
+// comparés sont décalés du bit de signe
+static inline __m256i cle_inf_mots(__m256i a, __m256i b) {
+    const __m256i signe = _mm256_set1_epi32(INT32_MIN);
+    return _mm256_cmpgt_epi32(_mm256_xor_si256(b, signe), _mm256_xor_si256(a, signe));
+}
+
+// a < b sur M bits, les mots de poids fort d'abord
+static inline __m256i cle_inf_vec(const __m256i *a, const __m256i *b) {
+    __m256i inf = cle_inf_mots(a[CLE_MOTS - 1], b[CLE_MOTS - 1]);
+    for (int k = CLE_MOTS - 2; k >= 0; k--) {
+        __m256i egal = _mm256_cmpeq_epi32(a[k], b[k]);
+        inf = _mm256_or_si256(cle_inf_mots(a[k], b[k]), _mm256_and_si256(egal, inf));
+    }
+    return inf;
+}
+
+static inline int find_next(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    const __m256i masque_haut = _mm256_set1_epi32((int)(uint32_t)((UINT64_C(1) << CLE_BITS_HAUTS) - 1));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i huit = _mm256_set1_epi32(8);
+    const __m256i index = _mm256_setr_epi32(0, CLE_MOTS, 2 * CLE_MOTS, 3 * CLE_MOTS, 4 * CLE_MOTS,
+                                            5 * CLE_MOTS, 6 * CLE_MOTS, 7 * CLE_MOTS);
+    // Un finger de distance nulle n'est jamais plus loin que le meilleur : il suffit que d < borne, ou
+    // que la borne soit nulle (key == id_p)
+    cle_t borne = cle_distance(id_p, key);
+    const __m256i tout = _mm256_set1_epi32(-cle_egal(borne, cle_depuis_u64(0)));
+    __m256i id[CLE_MOTS], b[CLE_MOTS], meilleur[CLE_MOTS];
+    for (int k = 0; k < CLE_MOTS; k++) {
+        id[k] = _mm256_set1_epi32((int)id_p.w[k]);
+        b[k] = _mm256_set1_epi32((int)borne.w[k]);
+        meilleur[k] = zero;
+    }
+    __m256i rangs = _mm256_set1_epi32(-1);
+    __m256i i_vec = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    int i = 0;
+    for (; i + 8 <= M; i += 8) {
+        // d = finger - id_p, mot par mot depuis le poids faible ; un emprunt vaut -1
+        const int *base = (const int *)(finger_table + i);
+        __m256i d[CLE_MOTS];
+        __m256i emprunt = zero;
+        for (int k = CLE_MOTS - 1; k >= 0; k--) {
+            __m256i f = _mm256_i32gather_epi32(base + k, index, 4);
+            d[k] = _mm256_add_epi32(_mm256_sub_epi32(f, id[k]), emprunt);
+            emprunt = _mm256_or_si256(cle_inf_mots(f, id[k]), _mm256_and_si256(_mm256_cmpeq_epi32(f, id[k]), emprunt));
+        }
+        d[0] = _mm256_and_si256(d[0], masque_haut);
+        __m256i candidat = _mm256_or_si256(cle_inf_vec(d, b), tout);
+        __m256i plus = _mm256_and_si256(candidat, cle_inf_vec(meilleur, d));
+        for (int k = 0; k < CLE_MOTS; k++) {
+            meilleur[k] = _mm256_blendv_epi8(meilleur[k], d[k], plus);
+        }
+        rangs = _mm256_blendv_epi8(rangs, i_vec, plus);
+        i_vec = _mm256_add_epi32(i_vec, huit);
+    }
+
+    // Réduction des huit voies puis fingers restants
+    uint32_t mots[CLE_MOTS][8];
+    int32_t rangs_voies[8];
+    for (int k = 0; k < CLE_MOTS; k++) {
+        _mm256_storeu_si256((__m256i *)mots[k], meilleur[k]);
+    }
+    _mm256_storeu_si256((__m256i *)rangs_voies, rangs);
+    int rank = -1, voie = 0;
+    for (int v = 0; v < 8; v++) {
+        int plus = rangs_voies[v] >= 0;
+        for (int k = 0; k < CLE_MOTS && rank >= 0; k++) {
+            if (mots[k][v] != mots[k][voie]) {
+                plus = mots[k][v] > mots[k][voie];
+                break;
+            }
+            plus = 0;
+        }
+        voie = plus ? v : voie;
+        rank = plus ? rangs_voies[v] : rank;
+    }
+    return i < M ? find_next_depuis(id_p, finger_table, key, i, rank) : rank;
+}
+
+#else
+
+static inline int find_next(cle_t id_p, const cle_t *finger_table, cle_t key) {
+    return find_next_depuis(id_p, finger_table, key, 0, -1);
+}
+
+#endif
+
+#endif
+
+/********** MPI **********/
+
+#ifdef MPI_VERSION
+
+// Type MPI correspondant à cle_t, initialisé par cle_init_mpi
+static MPI_Datatype CLE_MPI;
+
+static inline void cle_init_mpi(void) {
+#if M <= 64
+    CLE_MPI = MPI_UINT64_T;
+#else
+    MPI_Type_contiguous(CLE_MOTS, MPI_UINT32_T, &CLE_MPI);
+    MPI_Type_commit(&CLE_MPI);
+#endif
+}
+
+static inline void cle_liberer_mpi(void) {
+#if M > 64
+    MPI_Type_free(&CLE_MPI);
+#endif
+}
+
+#endif
+
+#endif
@@ -1,250 +1,2856 @@
 #include <mpi.h>
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "cache.h"
+#include "chord.h"
+#include "moteur.h"
+#include "pool.h"
+#include "stats.h"
+#include "stockage.h"
+#include "trace.h"
+
 // Paramètres
-#define M 5  // Nombre de bits pour les identifiants
+#define TAG_INIT 0
 #define TAG_LOOKUP 1
 #define TAG_QUIT 2
+#define TAG_REPONSE 3
+#define TAG_PUT 4
+#define TAG_GET 5
+#define TAG_DEL 6
+#define TAG_JOIN 7              // Début d'un join demandé par le simulateur, puis bilan du join
+#define TAG_JOIN_PRED 8         // Le nouveau pair se présente à son successeur
+#define TAG_JOIN_INFOS 9        // Réponse du successeur : prédécesseur, finger table et listes inverses
+#define TAG_JOIN_SUCC 10        // Le nouveau pair se présente à son prédécesseur
+#define TAG_JOIN_ACK 11         // Le prédécesseur a pris en compte son nouveau successeur
+#define TAG_MAJ_FINGER 12       // Une entrée de finger table doit désigner le nouveau pair
+#define TAG_MAJ_ACK 13          // Mise à jour appliquée, confirmée au nouveau pair
+#define TAG_INVERSE 14          // Inscription dans la liste inverse d'un finger
+#define TAG_TRANSFERT 15        // Clés confiées au nouveau pair par son successeur
+#define TAG_RETOUR 16           // Réponse ou refus renvoyé au rang d'entrée d'une requête (cache)
+#define TAG_REFERENCE 17        // Saut suivant d'un lookup itératif, renvoyé au demandeur
+#define TAG_CLIENT 18           // Charge de lookups confiée à un rang client, puis bilan du client
+#define TAG_STABILISER 19       // Un pair se présente à son successeur, qui lui répond en TAG_SUCCESSEURS
+#define TAG_SUCCESSEURS 20      // Prédécesseur et liste de successeurs du successeur
+#define TAG_PANNE 21            // Le simulateur réduit le rang au silence
+// Les messages TAG_JOIN à TAG_INVERSE, TAG_STABILISER et TAG_SUCCESSEURS adressés à un pair
+// commencent par un EnteteControle
+#define NB_TAGS 22
+
+// Phases mesurées par l'instrumentation
+#define PHASE_INIT 0
+#define PHASE_LOOKUP 1
+#define PHASE_STOCKAGE 2
+#define PHASE_JOIN 3
+#define PHASE_PANNE 4
+#define PHASE_RMA 5
+
+// Résultat d'une opération sur la table d'un pair
+#define STATUT_OK 0
+#define STATUT_ABSENT 1
+#define STATUT_REDIRIGE 2       // Le pair désigné par le cache n'est plus responsable de la clé
+
+// Passage d'une requête par le cache de son rang d'entrée
+#define CACHE_AUCUN 0           // Routée par les finger tables
+#define CACHE_SUCCES 1          // Envoyée directement au responsable trouvé dans le cache
+#define CACHE_IGNORE 2          // Routée de nouveau après un refus, sans le cache
+
+// Taille max de la clé et de la valeur transportées par une requête du simulateur
+#define DONNEES_MAX 512
+
+// Maintenance de l'anneau (-p) : à chaque période, un pair virtuel du rang à tour de rôle stabilise son
+// successeur et rafraîchit une entrée de sa finger table ; le trafic de maintenance d'un rang est ainsi
+// borné par la période quel que soit le nombre de pairs virtuels
+#ifndef NB_SUCCESSEURS
+#define NB_SUCCESSEURS 4            // Longueur de la liste de successeurs
+#endif
+#define MAINTENANCE_DELAI 4         // Tours d'un pair sans nouvelle d'un voisin avant de le considérer en panne
+#define MAINTENANCE_SOMMEIL_US 200  // Attente d'un rang inoccupé entre deux vérifications du minuteur
+
+// Routage par proximité (-a) : pairs examinés après chaque finger pour lui trouver un remplaçant sur le même nœud
+#define PROXIMITE_CANDIDATS 16
+
+// Nombre de pairs virtuels hébergés par chaque rang (-v)
+// Le pair virtuel v du rang r porte le numéro (r-1)*nb_virtuels + v + 1 : finger tables, prédécesseurs,
+// listes inverses et réponses désignent les pairs par ce numéro, égal au rang avec un pair par rang
+static int nb_virtuels = 1;
+
+static inline int numero_rang(int numero) {
+    return (numero - 1) / nb_virtuels + 1;
+}
+
+static inline int numero_virtuel(int numero) {
+    return (numero - 1) % nb_virtuels;
+}
+
+// Structure qui contient les informations d'initialisation pour un pair
+// Un pair qui n'est pas membre de l'anneau initial n'a que son id et attend l'ordre de join
+// Elle est envoyée avec un des types MPI de infos_types_creer, les champs sont dans l'ordre de ces types
+typedef struct {
+    cle_t id;
+    int membre;
+    cle_t pred;
+    int pred_rank;
+    cle_t finger_table[M];
+    int finger_table_rank[M];
+    int nb_successeurs;
+    cle_t successeurs[NB_SUCCESSEURS];
+    int successeurs_rank[NB_SUCCESSEURS];
+    cle_t proches[M];
+    int proches_rank[M];
+} Infos;
+
+// Types MPI des Infos, chacun préfixe du suivant : le simulateur n'envoie que les champs utiles au pair,
+// qui reçoit avec le même type directement dans sa structure
+#define INFOS_HORS_ANNEAU 0     // id et membre
+#define INFOS_MEMBRE 1          // Sans les pairs proches de -a
+#define INFOS_COMPLET 2
+static MPI_Datatype infos_types[3];
+
+void infos_types_creer(void) {
+    int longueurs[] = { 1, 1, 1, 1, M, M, 1, NB_SUCCESSEURS, NB_SUCCESSEURS, M, M };
+    MPI_Aint deplacements[] = {
+        offsetof(Infos, id), offsetof(Infos, membre), offsetof(Infos, pred), offsetof(Infos, pred_rank),
+        offsetof(Infos, finger_table), offsetof(Infos, finger_table_rank), offsetof(Infos, nb_successeurs),
+        offsetof(Infos, successeurs), offsetof(Infos, successeurs_rank), offsetof(Infos, proches),
+        offsetof(Infos, proches_rank)
+    };
+    MPI_Datatype types[] = {
+        CLE_MPI, MPI_INT, CLE_MPI, MPI_INT, CLE_MPI, MPI_INT, MPI_INT, CLE_MPI, MPI_INT, CLE_MPI, MPI_INT
+    };
+    int nb_champs[] = { 2, 9, 11 };
+    for (int k = 0; k < 3; k++) {
+        MPI_Datatype type;
+        MPI_Type_create_struct(nb_champs[k], longueurs, deplacements, types, &type);
+        MPI_Type_create_resized(type, 0, sizeof(Infos), &infos_types[k]);
+        MPI_Type_free(&type);
+        MPI_Type_commit(&infos_types[k]);
+    }
+}
+
+// Type des Infos d'un pair, que le simulateur et le pair déduisent tous deux des options
+static inline MPI_Datatype infos_type(int membre, int proximite) {
+    return infos_types[!membre ? INFOS_HORS_ANNEAU : proximite ? INFOS_COMPLET : INFOS_MEMBRE];
+}
+
+void infos_types_liberer(void) {
+    for (int k = 0; k < 3; k++) {
+        MPI_Type_free(&infos_types[k]);
+    }
+}
+
+// Référence à une entrée de finger table d'un pair, élément des listes inverses
+typedef struct {
+    cle_t id;
+    int rang;               // Numéro du pair
+    int entree;
+} RefFinger;
+
+// Entête des messages de contrôle adressés à un pair : numéro virtuel du pair sur le rang destinataire
+// Sa taille garde alignées les structures qui le suivent
+typedef struct {
+    int virtuel;
+    int reserve;
+} EnteteControle;
+
+// Ordre de join envoyé par le simulateur au pair virtuel qui doit rejoindre l'anneau
+typedef struct {
+    EnteteControle entete;
+    int init;               // Numéro du membre par lequel passer
+} DemandeJoin;
+
+// Etat d'un join en cours chez le nouveau pair
+typedef struct {
+    int etape;              // JOIN_* ci-dessous
+    int entree;             // Prochaine entrée de la finger table à construire
+    cle_t guess[M];         // Finger table du successeur, point de départ de la construction
+    int guess_rank[M];
+    int acks_attendus;      // Mises à jour de fingers à confirmer
+    int transferts_attendus;
+    int inscriptions;       // Inscriptions aux listes inverses pas encore reçues
+    int messages[4];        // Messages de chaque étape de ex3.txt
+    int lookups;            // Lookups de la construction de la finger table
+} Jonction;
+
+#define JOIN_AUCUN 0
+#define JOIN_SUCCESSEUR 1   // Attend la réponse au lookup de son id
+#define JOIN_INFOS 2        // Attend les informations du successeur
+#define JOIN_ACK 3          // Attend la confirmation du prédécesseur
+#define JOIN_FINGERS 4      // Construit sa finger table
+#define JOIN_FIN 5          // Attend confirmations, transferts et inscriptions
+
+// Etat d'un pair : sa position sur l'anneau, sa finger table et les entrées des autres pairs qui le
+// désignent (liste inverse) ; les rangs sont des numéros de pairs
+// pred_rank vaut 0 quand le prédécesseur est tombé en panne : le prochain pair qui se présente le remplace
+typedef struct {
+    cle_t id;
+    int rang;
+    cle_t pred;
+    int pred_rank;
+    cle_t *finger_table;
+    int *finger_table_rank;
+    RefFinger *inverses;
+    int nb_inverses;
+    int cap_inverses;
+    Jonction join;
+    cle_t successeurs[NB_SUCCESSEURS];  // Successeurs suivants, qui remplacent finger_table[0] s'il tombe en panne
+    int successeurs_rank[NB_SUCCESSEURS];
+    int nb_successeurs;
+    double attente_succ;    // Envoi du TAG_STABILISER resté sans réponse, 0 sinon
+    double nouvelles_pred;  // Dernier TAG_STABILISER reçu du prédécesseur
+    int finger_suivant;     // Prochaine entrée de la finger table à rafraîchir
+    cle_t proches[M];       // Avec -a, pair du même nœud dans l'intervalle de chaque finger, après lui
+    int proches_rank[M];    // 0 si l'intervalle n'en a pas
+    int64_t version;        // Avec -o, version de la table publiée dans la fenêtre
+} Pair;
+
+// Table d'un pair publiée dans la fenêtre des accès distants (-o)
+typedef struct {
+    cle_t finger_table[M];
+    int finger_table_rank[M];
+    cle_t id;
+} TablePubliee;
+
+// Place d'un pair dans la fenêtre : la table de la version v est dans tables[v & 1]
+typedef struct {
+    int64_t version;
+    TablePubliee tables[2];
+} FenetrePair;
+
+// Fenêtre des accès distants
+typedef struct {
+    MPI_Win win;
+    FenetrePair *pairs;     // Pairs du rang
+    FenetrePair **partages; // Sur le rang 0 avec une fenêtre partagée, adresse des pairs de chaque rang ; NULL sinon
+    int partagee;
+} Fenetre;
+
+// Processus hébergeant les pairs virtuels d'un rang et la table des clés dont ils sont responsables
+// Les pairs déjà dans l'anneau sont aussi rangés par id croissant pour trouver celui d'une clé
+// Les clés sont réparties en nb_parties tables selon les bits de poids faible de leur haché, chacune
+// protégée par un verrou : les ouvriers appliquent en parallèle les opérations sur des parties différentes
+typedef struct {
+    int rang;
+    Pair *pairs;            // Indexés par numéro virtuel
+    cle_t *ids_membres;     // Ids triés des pairs de l'anneau
+    int *membres;           // Numéro virtuel de chacun
+    int nb_membres;
+    int joignant;           // Numéro virtuel du pair dont le join est en cours, -1 sinon
+    Stockage *stockage;
+    pthread_mutex_t *verrous;
+    int nb_parties;         // Puissance de 2
+    Cache cache;            // Responsables appris par le rang quand il est l'entrée d'une requête (-c)
+    long long lookups_recus; // Messages de lookup traités, pour comparer la charge des rangs
+    int *noeuds;            // Avec -a, nœud de chaque rang, indexé par rang ; NULL sinon
+    long long sauts_noeud;  // Lookups transférés à un rang du même nœud
+    long long sauts_distants; // Lookups transférés à un rang d'un autre nœud
+    double periode;         // Période de maintenance en secondes, 0 sans maintenance
+    double prochain_tour;
+    int tour;               // Compte les tours, le pair virtuel suivant en dépend
+    unsigned char *suspects; // Rangs considérés en panne, indexés par rang
+    int nb_suspects;
+    double *entendus;       // Dernier message reçu de chaque rang, avec -p
+    int silencieux;         // Rang réduit au silence par le simulateur
+    Fenetre *fenetre;       // Avec -o, fenêtre qui expose les finger tables des pairs, NULL sinon
+} Hote;
+
+// Réponse du successeur à un nouveau pair, suivie de nb_inverses RefFinger
+typedef struct {
+    cle_t pred;
+    int pred_rank;
+    int nb_maj;             // Messages de mise à jour de fingers envoyés, chacun sera confirmé
+    int nb_transferts;      // Clés transférées
+    int nb_inverses;
+    cle_t finger_table[M];
+    int finger_table_rank[M];
+} InfosJonction;
+
+// Bilan d'un join renvoyé au simulateur
+typedef struct {
+    cle_t succ;
+    cle_t pred;
+    int messages[4];
+    int lookups;
+} BilanJonction;
+
+// Entête d'une requête, renvoyée à l'origine une fois résolue
+// Pour put, get et del elle est suivie de taille_cle octets de clé utilisateur puis de taille_valeur octets de valeur
+// Les champs ont une taille fixe : 32 octets d'entiers, puis les identifiants, dont l'alignement ne dépasse
+// pas 8. La structure n'a donc aucun octet de remplissage, et un lot est traité en place dans le tampon de
+// réception, sans copie de ses requêtes
+typedef struct {
+    int32_t req_id;     // Identifiant de la requête chez l'origine
+    int32_t origine;    // Rang du processus qui attend la réponse
+    int32_t rang_entree; // Premier rang à router la requête, 0 avant son arrivée
+    int32_t rang_responsable;
+    int32_t taille_cle;
+    int32_t taille_valeur;
+    uint16_t hops;      // Nombre de sauts effectués dans l'anneau
+    uint8_t op;         // Tag de la requête : TAG_LOOKUP, TAG_PUT, TAG_GET ou TAG_DEL, TAG_JOIN pour un lookup de join
+    uint8_t statut;     // STATUT_OK ou STATUT_ABSENT dans la réponse
+    uint8_t via_cache;  // CACHE_AUCUN, CACHE_SUCCES ou CACHE_IGNORE
+    uint8_t iteratif;   // Lookup itératif : chaque pair renvoie le saut suivant au demandeur
+    uint16_t reserve;
+    cle_t key;          // Cle recherchée
+    cle_t responsable;  // Id du pair responsable une fois résolue
+    cle_t pred_responsable; // Son prédécesseur : le responsable possède ]pred_responsable, responsable]
+} Requete;
+_Static_assert(sizeof(Requete) == 32 + 3 * sizeof(cle_t), "Requete ne doit pas avoir de remplissage");
+
+// Lot de requêtes à destination d'un même rang, sous forme d'enregistrements de taille variable
+// Les requêtes s'accumulent dans un tampon du moteur tant que l'envoi précédent est en vol
+typedef struct {
+    char *tampon;       // NULL tant que le lot est vide
+    int octets;
+    int en_vol;         // Envois de ce lot pas encore terminés
+    int en_attente;     // Le lot figure dans la liste des lots à envoyer
+} Lot;
+
+// Lots sortants d'un processus, indexés par tag puis par rang destinataire
+// Seuls les lots non vides sont parcourus pour l'envoi
+typedef struct {
+    Lot *lots;
+    int nb_rangs;
+    int *attente;
+    int nb_attente;
+    Moteur *moteur;
+} Envois;
+
+// Taille d'un enregistrement, arrondie pour garder l'entête suivant aligné
+static inline size_t requete_taille(const Requete *req) {
+    return (sizeof(Requete) + req->taille_cle + req->taille_valeur + 7) & ~(size_t)7;
+}
+
+// Clé utilisateur puis valeur qui suivent l'entête
+static inline char *requete_donnees(Requete *req) {
+    return (char *)(req + 1);
+}
+
+Lot *envois_lot(Envois *envois, int tag, int dest) {
+    return &envois->lots[tag * envois->nb_rangs + dest];
+}
+
+// Confie le lot au moteur, un nouveau tampon sera pris au prochain ajout
+void lot_envoyer(Envois *envois, int tag, int dest) {
+    Lot *lot = envois_lot(envois, tag, dest);
+    moteur_envoyer(envois->moteur, lot->tampon, lot->octets, dest, tag, &lot->en_vol);
+    lot->tampon = NULL;
+    lot->octets = 0;
+}
+
+// Ajoute une requête et ses données au lot à destination de dest
+void lot_ajouter(Envois *envois, int tag, int dest, const Requete *req, const void *donnees) {
+    Lot *lot = envois_lot(envois, tag, dest);
+    int taille = (int)requete_taille(req);
+    if (lot->octets + taille > MOTEUR_TAILLE) {
+        // Un lot plein part même si le précédent est encore en vol
+        lot_envoyer(envois, tag, dest);
+    }
+    if (lot->tampon == NULL) {
+        lot->tampon = moteur_tampon(envois->moteur);
+    }
+    if (!lot->en_attente) {
+        lot->en_attente = 1;
+        envois->attente[envois->nb_attente++] = tag * envois->nb_rangs + dest;
+    }
+    Requete *copie = (Requete *)(lot->tampon + lot->octets);
+    *copie = *req;
+    memcpy(requete_donnees(copie), donnees, req->taille_cle + req->taille_valeur);
+    lot->octets += taille;
+}
+
+// Envoie les lots en attente dont l'envoi précédent est terminé
+// Les autres continuent de grossir, ils partiront quand le moteur aura terminé leur envoi
+void lots_progresser(Envois *envois) {
+    int j = 0;
+    for (int k = 0; k < envois->nb_attente; k++) {
+        int l = envois->attente[k];
+        Lot *lot = &envois->lots[l];
+        if (lot->octets > 0 && lot->en_vol == 0) {
+            lot_envoyer(envois, l / envois->nb_rangs, l % envois->nb_rangs);
+        }
+        if (lot->octets > 0) {
+            envois->attente[j++] = l;
+        } else {
+            lot->en_attente = 0;
+        }
+    }
+    envois->nb_attente = j;
+}
+
+void envois_creer(Envois *envois, int nb_rangs, Moteur *moteur) {
+    envois->nb_rangs = nb_rangs;
+    envois->moteur = moteur;
+    envois->lots = (Lot *)calloc(NB_TAGS * nb_rangs, sizeof(Lot));
+    envois->attente = (int *)malloc(NB_TAGS * nb_rangs * sizeof(int));
+    envois->nb_attente = 0;
+}
+
+// Les envois en vol appartiennent au moteur, seuls les lots jamais partis sont rendus ici
+void envois_liberer(Envois *envois) {
+    for (int l = 0; l < NB_TAGS * envois->nb_rangs; l++) {
+        if (envois->lots[l].tampon != NULL) moteur_rendre(envois->moteur, envois->lots[l].tampon);
+    }
+    free(envois->lots);
+    free(envois->attente);
+}
+
+void hote_stockage_init(Hote *h, int nb_parties) {
+    h->nb_parties = nb_parties;
+    h->stockage = (Stockage *)malloc(nb_parties * sizeof(Stockage));
+    h->verrous = (pthread_mutex_t *)malloc(nb_parties * sizeof(pthread_mutex_t));
+    for (int k = 0; k < nb_parties; k++) {
+        stockage_init(&h->stockage[k]);
+        pthread_mutex_init(&h->verrous[k], NULL);
+    }
+}
+
+void hote_stockage_liberer(Hote *h) {
+    for (int k = 0; k < h->nb_parties; k++) {
+        stockage_liberer(&h->stockage[k]);
+        pthread_mutex_destroy(&h->verrous[k]);
+    }
+    free(h->stockage);
+    free(h->verrous);
+}
+
+// Partie de la table qui contient la clé hachée key
+static inline int hote_partie(const Hote *h, cle_t key) {
+    return (int)(cle_poids_faible(key) & (uint32_t)(h->nb_parties - 1));
+}
+
+// Ajoute le pair virtuel v aux membres de l'anneau hébergés par le rang
+void hote_ajouter_membre(Hote *h, int v) {
+    int j = h->nb_membres;
+    while (j > 0 && cle_cmp(h->ids_membres[j-1], h->pairs[v].id) > 0) {
+        h->ids_membres[j] = h->ids_membres[j-1];
+        h->membres[j] = h->membres[j-1];
+        j--;
+    }
+    h->ids_membres[j] = h->pairs[v].id;
+    h->membres[j] = v;
+    h->nb_membres++;
+}
+
+// Pair local par lequel une requête arrivant sur le rang commence : le responsable de la clé s'il est
+// hébergé ici, sinon le pair local le plus proche avant la clé, qui est au moins aussi proche que le
+// finger auquel la requête a été envoyée
+const Pair *hote_pair(const Hote *h, cle_t key) {
+    int j = successeur_trie(h->ids_membres, h->nb_membres, key);
+    const Pair *p = &h->pairs[h->membres[j]];
+    if (cle_dans_intervalle(key, p->pred, p->id)) return p;
+    return &h->pairs[h->membres[(j - 1 + h->nb_membres) % h->nb_membres]];
+}
+
+// Le rang qui héberge le pair numero est suspecté de panne
+static inline int suspect(const Hote *h, int numero) {
+    return h->nb_suspects > 0 && h->suspects[numero_rang(numero)];
+}
+
+// Successeur de p qui répond : finger_table[0], ou s'il est suspecté le premier de sa liste de successeurs
+// qui ne l'est pas, en attendant que la maintenance le remplace
+// Quand toute la liste est suspectée (des pairs virtuels consécutifs sur les rangs en panne), c'est le
+// finger vivant le plus proche : la stabilisation remonte ensuite son prédécesseur jusqu'au vrai successeur
+static inline void successeur_vivant(const Hote *h, const Pair *p, cle_t *id, int *numero) {
+    *id = p->finger_table[0];
+    *numero = p->finger_table_rank[0];
+    for (int k = 0; k < p->nb_successeurs && suspect(h, *numero); k++) {
+        *id = p->successeurs[k];
+        *numero = p->successeurs_rank[k];
+    }
+    for (int i = 1; i < M && suspect(h, *numero); i++) {
+        *id = p->finger_table[i];
+        *numero = p->finger_table_rank[i];
+    }
+}
+
+// Coût d'un saut vers le pair numero avec -a : nul sur le même rang, moindre sur le même nœud
+static inline int saut_cout(const Hote *h, int numero) {
+    int r = numero_rang(numero);
+    if (r == h->rang) return 0;
+    return h->noeuds[r] == h->noeuds[h->rang] ? 1 : 2;
+}
+
+// Avec -a le saut choisi est remplacé par un pair moins coûteux à joindre qui se trouve entre lui et la
+// clé : plus proche de la clé, il n'allonge pas la route. Les candidats sont les pairs du même nœud
+// retenus pour chaque intervalle de finger et la liste de successeurs
+static void saut_proximite(const Hote *h, const Pair *p, cle_t key, cle_t *id, int *numero) {
+    int cout = saut_cout(h, *numero);
+    for (int j = 0; j < M + p->nb_successeurs && cout > 0; j++) {
+        cle_t c = j < M ? p->proches[j] : p->successeurs[j - M];
+        int n = j < M ? p->proches_rank[j] : p->successeurs_rank[j - M];
+        if (n == 0 || suspect(h, n) || cle_cmp(c, key) == 0 || !cle_dans_intervalle(c, *id, key)) continue;
+        int cout_c = saut_cout(h, n);
+        if (cout_c < cout) {
+            cout = cout_c;
+            *id = c;
+            *numero = n;
+        }
+    }
+}
+
+// Prochain saut de p vers la clé : le finger choisi par find_next, ou 0 si le successeur en est responsable
+// Quand des rangs sont suspectés, c'est le pair le plus proche avant la clé parmi les fingers et la liste
+// de successeurs qui ne sont pas suspectés : les lookups contournent les pairs en panne
+int prochain_saut(const Hote *h, const Pair *p, cle_t key, cle_t *id, int *numero) {
+    if (h->nb_suspects == 0) {
+        int next = find_next(p->id, p->finger_table, key);
+        if (next == -1) return 0;
+        *id = p->finger_table[next];
+        *numero = p->finger_table_rank[next];
+        if (h->noeuds != NULL) saut_proximite(h, p, key, id, numero);
+        return 1;
+    }
+
+    int trouve = 0;
+    cle_t distance = p->id;
+    for (int i = 0; i < M + p->nb_successeurs; i++) {
+        cle_t f = i < M ? p->finger_table[i] : p->successeurs[i - M];
+        int n = i < M ? p->finger_table_rank[i] : p->successeurs_rank[i - M];
+        if (n == p->rang || suspect(h, n) || cle_cmp(f, key) == 0 || !cle_dans_intervalle(f, p->id, key)) continue;
+        cle_t d = cle_distance(p->id, f);
+        if (!trouve || cle_cmp(d, distance) > 0) {
+            trouve = 1;
+            distance = d;
+            *id = f;
+            *numero = n;
+        }
+    }
+    if (trouve && h->noeuds != NULL) saut_proximite(h, p, key, id, numero);
+    return trouve;
+}
+
+/********** CACHE **********/
+
+// Avec -c le rang qui reçoit une requête du simulateur en est l'entrée : il cherche le responsable de
+// la clé dans son cache et lui envoie directement la requête, en un saut. Sinon la requête est routée
+// par les finger tables et sa réponse passe par le rang d'entrée, qui apprend le responsable et
+// l'intervalle qu'il possède avant de la relayer à l'origine. Un pair désigné par le cache qui n'est
+// plus responsable de la clé (après un join) renvoie la requête au rang d'entrée, qui vide la case
+// et la route de nouveau sans le cache
+
+// Appelé quand la requête arrive sur le rang, p étant le pair local par lequel elle commence
+// Retourne 1 si la requête doit être routée ici, 0 si elle est partie ailleurs
+int cache_aiguiller(Hote *h, int tag, Requete *req, const Pair *p, Envois *envois) {
+    if (h->cache.taille == 0 || req->iteratif) return 1;
+    int possede = cle_dans_intervalle(req->key, p->pred, p->id);
+
+    if (req->rang_entree == 0) {
+        req->rang_entree = h->rang;
+        if (possede) return 1;
+        int numero = cache_chercher(&h->cache, req->key);
+        if (numero == 0) return 1;
+        if (numero_rang(numero) == h->rang || suspect(h, numero)) {
+            // Un pair local désigné par le cache aurait été trouvé par hote_pair
+            cache_invalider(&h->cache, req->key, numero);
+            return 1;
+        }
+        req->via_cache = CACHE_SUCCES;
+        req->rang_responsable = numero;
+        req->hops++;
+        lot_ajouter(envois, tag, numero_rang(numero), req, requete_donnees(req));
+        return 0;
+    }
+
+    if (req->via_cache == CACHE_SUCCES && !possede) {
+        req->statut = STATUT_REDIRIGE;
+        req->hops++;
+        lot_ajouter(envois, TAG_RETOUR, req->rang_entree, req, requete_donnees(req));
+        return 0;
+    }
+    return 1;
+}
+
+// Envoie la réponse à l'origine, ou à son rang d'entrée quand celui-ci doit apprendre le responsable
+void repondre(const Hote *h, const Requete *rep, const char *valeur, Envois *envois) {
+    if (h->cache.taille > 0 && rep->via_cache != CACHE_SUCCES && rep->rang_entree != 0
+            && rep->rang_entree != h->rang && rep->rang_entree != rep->origine) {
+        lot_ajouter(envois, TAG_RETOUR, rep->rang_entree, rep, valeur);
+    } else {
+        lot_ajouter(envois, TAG_REPONSE, rep->origine, rep, valeur);
+    }
+}
+
+/********** ROUTAGE **********/
+
+// Cherche la cle de la requête dans la DHT
+// La requête est soit transférée au finger trouvé, soit résolue et renvoyée à son origine
+// En mode itératif le finger trouvé est renvoyé à l'origine, qui le contacte elle-même
+// Un finger hébergé par le même rang est suivi directement, sans message
+void lookup(Hote *h, Requete *req, Envois *envois) {
+    char tmp[CLE_STR];
+    const Pair *p = hote_pair(h, req->key);
+    __atomic_add_fetch(&h->lookups_recus, 1, __ATOMIC_RELAXED);
+    if (!cache_aiguiller(h, TAG_LOOKUP, req, p, envois)) return;
+    for (;;) {
+        if (cle_dans_intervalle(req->key, p->pred, p->id)) {
+            // La clé est dans ]pred, id] : le pair en est responsable
+            TRACE(TRACE_DEBUG, "\t=> Le pair %s possède la clé.\n", cle_str(p->id, tmp));
+            req->responsable = p->id;
+            req->pred_responsable = p->pred;
+            req->rang_responsable = p->rang;
+            repondre(h, req, NULL, envois);
+            return;
+        }
+        cle_t id_suivant;
+        int suivant;
+        if (!prochain_saut(h, p, req->key, &id_suivant, &suivant)) {
+            // Le successeur possede la cle
+            TRACE(TRACE_DEBUG, "\t=> Le successeur de %s possède la clé.\n", cle_str(p->id, tmp));
+            successeur_vivant(h, p, &req->responsable, &req->rang_responsable);
+            req->pred_responsable = p->id;
+            repondre(h, req, NULL, envois);
+            return;
+        }
+        if (numero_rang(suivant) != h->rang && req->iteratif) {
+            // L'origine contactera le finger trouvé
+            TRACE(TRACE_DEBUG, "\t=> Renvoi du finger %s à l'origine.\n", cle_str(id_suivant, tmp));
+            req->responsable = id_suivant;
+            req->rang_responsable = suivant;
+            req->hops++;
+            lot_ajouter(envois, TAG_REFERENCE, req->origine, req, NULL);
+            return;
+        }
+        if (numero_rang(suivant) != h->rang) {
+            // Transfer du lookup au finger trouvé
+            TRACE(TRACE_DEBUG, "\t=> Transfert du lookup au pair %s.\n", cle_str(id_suivant, tmp));
+            if (h->noeuds != NULL) {
+                __atomic_add_fetch(saut_cout(h, suivant) == 1 ? &h->sauts_noeud : &h->sauts_distants, 1, __ATOMIC_RELAXED);
+            }
+            req->hops++;
+            lot_ajouter(envois, TAG_LOOKUP, numero_rang(suivant), req, NULL);
+            return;
+        }
+        // Le finger, strictement plus proche de la clé, est un pair virtuel du même rang
+        TRACE(TRACE_DEBUG, "\t=> Saut local vers le pair %s.\n", cle_str(id_suivant, tmp));
+        p = &h->pairs[numero_virtuel(suivant)];
+    }
+}
+
+// Applique un put, get ou del sur la table locale si la clé est dans ]pred, id]
+// Sinon la requête suit le même routage que lookup, le dernier saut allant jusqu'au successeur
+// Seuls les sauts vers un finger local sont faits sans message : ils rapprochent strictement de la clé
+void operation_stockage(Hote *h, int tag, Requete *req, Envois *envois) {
+    char tmp[CLE_STR];
+    char *donnees = requete_donnees(req);
+    const Pair *p = hote_pair(h, req->key);
+    if (!cache_aiguiller(h, tag, req, p, envois)) return;
+
+    while (!cle_dans_intervalle(req->key, p->pred, p->id)) {
+        cle_t id_dest;
+        int dest;
+        int finger = prochain_saut(h, p, req->key, &id_dest, &dest);
+        if (!finger) successeur_vivant(h, p, &id_dest, &dest);
+        if (finger && numero_rang(dest) == h->rang) {
+            p = &h->pairs[numero_virtuel(dest)];
+            continue;
+        }
+        TRACE(TRACE_DEBUG, "\t=> Transfert de la requête %d au pair %s.\n", req->req_id, cle_str(id_dest, tmp));
+        req->hops++;
+        lot_ajouter(envois, tag, numero_rang(dest), req, donnees);
+        return;
+    }
+
+    // La réponse ne transporte que la valeur d'un get
+    Requete rep = *req;
+    rep.responsable = p->id;
+    rep.pred_responsable = p->pred;
+    rep.rang_responsable = p->rang;
+    rep.statut = STATUT_OK;
+    rep.taille_cle = 0;
+    rep.taille_valeur = 0;
+    const char *valeur = NULL;
+    int k = hote_partie(h, req->key);
+    Stockage *s = &h->stockage[k];
+    // La valeur d'un get pointe dans l'arène, le verrou est gardé jusqu'à sa copie dans le lot
+    pthread_mutex_lock(&h->verrous[k]);
+    if (tag == TAG_PUT) {
+        stockage_put(s, donnees, req->taille_cle, donnees + req->taille_cle, req->taille_valeur);
+    } else if (tag == TAG_GET) {
+        size_t taille;
+        valeur = stockage_get(s, donnees, req->taille_cle, &taille);
+        if (valeur != NULL) {
+            rep.taille_valeur = (int)taille;
+        } else {
+            rep.statut = STATUT_ABSENT;
+        }
+    } else if (!stockage_del(s, donnees, req->taille_cle)) {
+        rep.statut = STATUT_ABSENT;
+    }
+    TRACE(TRACE_DEBUG, "\t=> Le pair %s applique la requête %d (statut %d).\n", cle_str(p->id, tmp), req->req_id, rep.statut);
+    repondre(h, &rep, valeur, envois);
+    pthread_mutex_unlock(&h->verrous[k]);
+}
+
+// Requête revenue à son rang d'entrée : refusée elle est routée de nouveau, résolue elle est relayée
+void cache_retour(Hote *h, Requete *req, Envois *envois) {
+    if (req->statut == STATUT_REDIRIGE) {
+        cache_invalider(&h->cache, req->key, req->rang_responsable);
+        req->statut = STATUT_OK;
+        req->via_cache = CACHE_IGNORE;
+        if (req->op == TAG_LOOKUP) {
+            lookup(h, req, envois);
+        } else {
+            operation_stockage(h, req->op, req, envois);
+        }
+        return;
+    }
+    cache_ajouter(&h->cache, req->key, req->pred_responsable, req->responsable, req->rang_responsable);
+    lot_ajouter(envois, TAG_REPONSE, req->origine, req, requete_donnees(req));
+}
+
+/********** JOIN **********/
+
+// Déroulement d'un join selon ex3.txt, le nouveau pair ne connaissant que init_p :
+//   1. lookup de son id pour trouver son successeur
+//   2. le successeur lui donne son ancien prédécesseur, puis le prédécesseur prend le nouveau pair comme successeur
+//   3. construction de la finger table, une entrée étant déduite de la précédente quand sa cible la précède
+//      et sinon cherchée à partir du finger correspondant du successeur, qui répond directement s'il est exact
+//   4. les entrées des autres pairs qui doivent désigner le nouveau pair sont celles de la liste inverse du
+//      successeur dont la cible tombe dans ]pred, nouveau] ; elles sont mises à jour et passent dans sa liste inverse
+
+void inverse_ajouter(Pair *p, const RefFinger *ref) {
+    if (p->nb_inverses == p->cap_inverses) {
+        p->cap_inverses = p->cap_inverses ? 2 * p->cap_inverses : 2 * M;
+        p->inverses = (RefFinger *)realloc(p->inverses, p->cap_inverses * sizeof(RefFinger));
+    }
+    p->inverses[p->nb_inverses++] = *ref;
+}
+
+// Tampon d'un message de contrôle pour le pair de numéro dest, l'entête est rempli
+// Retourne le tampon, les données commencent après l'entête
+char *controle_tampon(Envois *envois, int dest) {
+    char *tampon = moteur_tampon(envois->moteur);
+    EnteteControle *entete = (EnteteControle *)tampon;
+    entete->virtuel = numero_virtuel(dest);
+    entete->reserve = 0;
+    return tampon;
+}
+
+// Message de contrôle du join, envoyé hors des lots au pair de numéro dest
+void envoyer_controle(Envois *envois, const void *donnees, int octets, int dest, int tag) {
+    char *tampon = controle_tampon(envois, dest);
+    memcpy(tampon + sizeof(EnteteControle), donnees, octets);
+    moteur_envoyer(envois->moteur, tampon, sizeof(EnteteControle) + octets, numero_rang(dest), tag, NULL);
+}
+
+// Lookup émis par le nouveau pair, la réponse revient à son rang en TAG_REPONSE
+void join_lookup(const Hote *h, int req_id, cle_t cible, int dest, Envois *envois) {
+    Requete req;
+    memset(&req, 0, sizeof(Requete));
+    req.req_id = req_id;
+    req.origine = h->rang;
+    req.rang_entree = h->rang;
+    req.op = TAG_JOIN;
+    req.key = cible;
+    lot_ajouter(envois, TAG_LOOKUP, numero_rang(dest), &req, NULL);
+}
+
+// Etape 1 : le nouveau pair cherche son successeur en passant par init_p
+void join_demarrer(Hote *h, Pair *p, int init_rank, Envois *envois) {
+    char tmp[CLE_STR];
+    TRACE(TRACE_INFO, "Pair %s : join par le pair %d.\n", cle_str(p->id, tmp), init_rank);
+    memset(&p->join, 0, sizeof(Jonction));
+    p->join.etape = JOIN_SUCCESSEUR;
+    h->joignant = numero_virtuel(p->rang);
+    join_lookup(h, -1, p->id, init_rank, envois);
+    p->join.messages[0]++;
+}
+
+// Etape 2 chez le successeur : le nouveau pair devient son prédécesseur
+// Répond avec l'ancien prédécesseur, la finger table et les entrées de la liste inverse qui changent de pair
+// Les entrées qui ne tiennent pas dans la réponse sont envoyées à part en TAG_INVERSE
+void join_accueillir(Hote *h, Pair *p, const RefFinger *nouveau, Envois *envois) {
+    char *tampon = controle_tampon(envois, nouveau->rang);
+    InfosJonction *infos = (InfosJonction *)(tampon + sizeof(EnteteControle));
+    int max_reponse = (MOTEUR_TAILLE - sizeof(EnteteControle) - sizeof(InfosJonction)) / sizeof(RefFinger);
+    int max_inverse = (MOTEUR_TAILLE - sizeof(EnteteControle)) / sizeof(RefFinger);
+    RefFinger *deplaces = (RefFinger *)malloc((p->nb_inverses + 1) * sizeof(RefFinger));
+    int nb_deplaces = 0;
+    char tmp[CLE_STR];
+
+    infos->pred = p->pred;
+    infos->pred_rank = p->pred_rank;
+    infos->nb_maj = 0;
+    infos->nb_transferts = 0;
+    infos->nb_inverses = 0;
+    memcpy(infos->finger_table, p->finger_table, M * sizeof(cle_t));
+    memcpy(infos->finger_table_rank, p->finger_table_rank, M * sizeof(int));
+
+    // Etape 4 : une entrée qui désignait ce pair désigne le nouveau si sa cible est dans ]ancien pred, nouveau]
+    int j = 0;
+    for (int k = 0; k < p->nb_inverses; k++) {
+        RefFinger ref = p->inverses[k];
+        cle_t cible = cle_ajoute_puissance2(ref.id, ref.entree);
+        if (!cle_dans_intervalle(cible, p->pred, nouveau->id)) {
+            p->inverses[j++] = ref;
+        } else {
+            deplaces[nb_deplaces++] = ref;
+        }
+    }
+    p->nb_inverses = j;
+
+    // Une seule mise à jour par pair concerné, avec toutes ses entrées
+    // Le successeur du prédécesseur est mis à jour directement par le nouveau pair
+    RefFinger maj[M];
+    for (int k = 0; k < nb_deplaces; k++) {
+        int deja = 0;
+        for (int l = 0; l < k; l++) {
+            if (deplaces[l].rang == deplaces[k].rang) deja = 1;
+        }
+        if (deja) continue;
+        int nb = 0;
+        for (int l = k; l < nb_deplaces; l++) {
+            if (deplaces[l].rang != deplaces[k].rang) continue;
+            if (deplaces[l].rang == p->pred_rank && deplaces[l].entree == 0) continue;
+            maj[nb].id = nouveau->id;
+            maj[nb].rang = nouveau->rang;
+            maj[nb].entree = deplaces[l].entree;
+            nb++;
+        }
+        if (nb == 0) continue;
+        envoyer_controle(envois, maj, nb * sizeof(RefFinger), deplaces[k].rang, TAG_MAJ_FINGER);
+        infos->nb_maj++;
+    }
+
+    // Les clés de ]ancien pred, nouveau] sont confiées au nouveau pair, sauf s'il partage la table de ce rang
+    for (int k = 0; k < h->nb_parties && numero_rang(nouveau->rang) != h->rang; k++) {
+        Stockage *s = &h->stockage[k];
+        for (size_t i = 0; i < s->capacite; i++) {
+            Case *c = &s->cases[i];
+            if (c->empreinte <= STOCKAGE_SUPPRIME) continue;
+            Requete rec;
+            memset(&rec, 0, sizeof(Requete));
+            rec.op = TAG_PUT;
+            rec.taille_cle = c->taille_cle;
+            rec.taille_valeur = c->taille_valeur;
+            rec.key = hash_cle(stockage_cle(s, c), c->taille_cle);
+            if (!cle_dans_intervalle(rec.key, p->pred, nouveau->id)) continue;
+            lot_ajouter(envois, TAG_TRANSFERT, numero_rang(nouveau->rang), &rec, stockage_cle(s, c));
+            stockage_del(s, stockage_cle(s, c), c->taille_cle);
+            infos->nb_transferts++;
+        }
+    }
+
+    TRACE(TRACE_INFO, "Pair %s : nouveau prédécesseur, %d pairs à mettre à jour, %d clés transférées.\n",
+          cle_str(p->id, tmp), infos->nb_maj, infos->nb_transferts);
+    p->pred = nouveau->id;
+    p->pred_rank = nouveau->rang;
+    p->nouvelles_pred = MPI_Wtime();
+    infos->nb_inverses = nb_deplaces < max_reponse ? nb_deplaces : max_reponse;
+    memcpy(infos + 1, deplaces, infos->nb_inverses * sizeof(RefFinger));
+    for (int k = infos->nb_inverses; k < nb_deplaces; k += max_inverse) {
+        int nb = nb_deplaces - k < max_inverse ? nb_deplaces - k : max_inverse;
+        envoyer_controle(envois, deplaces + k, nb * sizeof(RefFinger), nouveau->rang, TAG_INVERSE);
+    }
+    free(deplaces);
+    moteur_envoyer(envois->moteur, tampon,
+                   sizeof(EnteteControle) + sizeof(InfosJonction) + infos->nb_inverses * sizeof(RefFinger),
+                   numero_rang(nouveau->rang), TAG_JOIN_INFOS, NULL);
+}
+
+// Etape 3 : complète la finger table du nouveau pair, un lookup à la fois
+// Une fois la table complète le pair s'inscrit dans la liste inverse de chacun de ses fingers
+void join_fingers(const Hote *h, Pair *p, Envois *envois) {
+    Jonction *j = &p->join;
+    while (j->entree < M) {
+        int i = j->entree;
+        cle_t cible = cle_ajoute_puissance2(p->id, i);
+        if (cle_dans_intervalle(cible, p->id, p->finger_table[i-1])) {
+            // La cible précède le finger précédent : même successeur, sans message
+            p->finger_table[i] = p->finger_table[i-1];
+            p->finger_table_rank[i] = p->finger_table_rank[i-1];
+            j->entree++;
+            continue;
+        }
+        join_lookup(h, i, cible, j->guess_rank[i], envois);
+        j->lookups++;
+        j->messages[2]++;
+        return;
+    }
+
+    j->etape = JOIN_FIN;
+    RefFinger refs[M];
+    for (int i = 0; i < M; i++) {
+        int deja = 0;
+        for (int k = 0; k < i; k++) {
+            if (p->finger_table_rank[k] == p->finger_table_rank[i]) deja = 1;
+        }
+        if (deja) continue;
+        int nb = 0;
+        for (int k = i; k < M; k++) {
+            if (p->finger_table_rank[k] != p->finger_table_rank[i]) continue;
+            refs[nb].id = p->id;
+            refs[nb].rang = p->rang;
+            refs[nb].entree = k;
+            nb++;
+        }
+        // Envoi synchrone : le join n'est terminé qu'une fois toutes les inscriptions reçues
+        char *tampon = controle_tampon(envois, p->finger_table_rank[i]);
+        memcpy(tampon + sizeof(EnteteControle), refs, nb * sizeof(RefFinger));
+        moteur_envoyer_synchrone(envois->moteur, tampon, sizeof(EnteteControle) + nb * sizeof(RefFinger),
+                                 numero_rang(p->finger_table_rank[i]), TAG_INVERSE, &j->inscriptions);
+        j->messages[3]++;
+    }
+}
+
+// Réponse à un lookup émis par le nouveau pair
+void join_reponse(const Hote *h, Pair *p, const Requete *rep, Envois *envois) {
+    Jonction *j = &p->join;
+    if (j->etape == JOIN_SUCCESSEUR) {
+        j->messages[0] += rep->hops + 1;
+        p->finger_table[0] = rep->responsable;
+        p->finger_table_rank[0] = rep->rang_responsable;
+        p->successeurs[0] = rep->responsable;
+        p->successeurs_rank[0] = rep->rang_responsable;
+        p->nb_successeurs = 1;
+        RefFinger moi = { p->id, p->rang, -1 };
+        envoyer_controle(envois, &moi, sizeof(RefFinger), rep->rang_responsable, TAG_JOIN_PRED);
+        j->messages[1]++;
+        j->etape = JOIN_INFOS;
+    } else if (j->etape == JOIN_FINGERS && rep->req_id == j->entree) {
+        j->messages[2] += rep->hops + 1;
+        p->finger_table[j->entree] = rep->responsable;
+        p->finger_table_rank[j->entree] = rep->rang_responsable;
+        j->entree++;
+        join_fingers(h, p, envois);
+    }
+}
+
+// Informations du successeur : le nouveau pair prend sa place entre pred et succ
+// Il peut dès lors recevoir des requêtes, son rang le compte parmi les membres de l'anneau
+void join_infos(Hote *h, Pair *p, const InfosJonction *infos, Envois *envois) {
+    Jonction *j = &p->join;
+    p->pred = infos->pred;
+    p->pred_rank = infos->pred_rank;
+    p->nouvelles_pred = MPI_Wtime();
+    const RefFinger *deplaces = (const RefFinger *)(infos + 1);
+    for (int k = 0; k < infos->nb_inverses; k++) {
+        inverse_ajouter(p, &deplaces[k]);
+    }
+
+    // La finger table du successeur sert de table provisoire : ce sont des pairs de l'anneau,
+    // le routage reste correct pendant la construction
+    memcpy(j->guess, infos->finger_table, M * sizeof(cle_t));
+    memcpy(j->guess_rank, infos->finger_table_rank, M * sizeof(int));
+    for (int i = 1; i < M; i++) {
+        p->finger_table[i] = infos->finger_table[i];
+        p->finger_table_rank[i] = infos->finger_table_rank[i];
+    }
+    j->acks_attendus += infos->nb_maj;
+    j->transferts_attendus += infos->nb_transferts;
+    j->messages[1]++;
+    j->messages[3] += 2 * infos->nb_maj;
+    hote_ajouter_membre(h, numero_virtuel(p->rang));
+
+    RefFinger moi = { p->id, p->rang, 0 };
+    envoyer_controle(envois, &moi, sizeof(RefFinger), p->pred_rank, TAG_JOIN_SUCC);
+    j->messages[1]++;
+    j->etape = JOIN_ACK;
+}
+
+// Envoie le bilan au simulateur quand plus rien n'est attendu
+void join_terminer(Hote *h, Envois *envois) {
+    if (h->joignant < 0) return;
+    Pair *p = &h->pairs[h->joignant];
+    Jonction *j = &p->join;
+    if (j->etape != JOIN_FIN || j->acks_attendus > 0 || j->transferts_attendus > 0 || j->inscriptions > 0) return;
+    char *tampon = moteur_tampon(envois->moteur);
+    BilanJonction *bilan = (BilanJonction *)tampon;
+    bilan->succ = p->finger_table[0];
+    bilan->pred = p->pred;
+    memcpy(bilan->messages, j->messages, sizeof(j->messages));
+    bilan->lookups = j->lookups;
+    moteur_envoyer(envois->moteur, tampon, sizeof(BilanJonction), 0, TAG_JOIN, NULL);
+    j->etape = JOIN_AUCUN;
+    h->joignant = -1;
+}
+
+/********** MAINTENANCE **********/
+
+// Protocole de stabilisation de Chord, mené à chaque période par un pair virtuel du rang :
+//   - stabilize : le pair se présente à son successeur (TAG_STABILISER), qui le prend comme prédécesseur
+//     s'il est plus proche que l'actuel (notify) et répond avec son prédécesseur et sa liste de
+//     successeurs (TAG_SUCCESSEURS) ; un prédécesseur du successeur intercalé devient le successeur
+//   - check_predecessor : un prédécesseur qui ne s'est pas présenté depuis MAINTENANCE_DELAI tours est
+//     oublié, un successeur qui ne répond pas est remplacé par le suivant de la liste
+//   - fix_fingers : une entrée de la finger table est recherchée par un lookup dont la réponse la met à jour
+// Un voisin muet fait suspecter son rang, que le routage évite jusqu'à ce qu'un message en arrive
+// Les rangs suspectés accompagnent la réponse du successeur : la suspicion remonte l'anneau jusqu'aux
+// rangs dont les fingers désignent le rang en panne, qui sinon ne s'en apercevraient pas
+// Les listes inverses ne sont tenues à jour que par le join : fix_fingers corrige les entrées qu'elles manquent
+
+// Voisinage d'un pair renvoyé en TAG_SUCCESSEURS, suivi de nb_suspects rangs
+typedef struct {
+    cle_t id;
+    int rang;
+    int pred_rank;          // 0 si le prédécesseur est inconnu
+    cle_t pred;
+    int nb_successeurs;
+    cle_t successeurs[NB_SUCCESSEURS];
+    int successeurs_rank[NB_SUCCESSEURS];
+    int nb_suspects;
+} Voisinage;
+
+void suspecter(Hote *h, int numero) {
+    int r = numero_rang(numero);
+    if (r == h->rang || h->suspects[r]) return;
+    h->suspects[r] = 1;
+    h->nb_suspects++;
+    TRACE(TRACE_INFO, "Rang %d : le rang %d ne répond plus.\n", h->rang, r);
+}
+
+// Un message reçu du rang montre qu'il répond
+void rehabiliter(Hote *h, int rang) {
+    h->suspects[rang] = 0;
+    h->nb_suspects--;
+    TRACE(TRACE_INFO, "Rang %d : le rang %d répond de nouveau.\n", h->rang, rang);
+}
+
+// Le nouveau successeur passe devant la liste
+void successeurs_devant(Pair *p, cle_t id, int numero) {
+    int nb = p->nb_successeurs < NB_SUCCESSEURS ? p->nb_successeurs + 1 : NB_SUCCESSEURS;
+    for (int k = nb - 1; k > 0; k--) {
+        p->successeurs[k] = p->successeurs[k-1];
+        p->successeurs_rank[k] = p->successeurs_rank[k-1];
+    }
+    p->successeurs[0] = id;
+    p->successeurs_rank[0] = numero;
+    p->nb_successeurs = nb;
+}
+
+// Le successeur reçoit la présentation d'un pair qui le précède peut-être
+void stab_accueillir(Hote *h, Pair *p, const RefFinger *ref, Envois *envois) {
+    if (p->pred_rank == 0 || suspect(h, p->pred_rank)
+            || (cle_dans_intervalle(ref->id, p->pred, p->id) && cle_cmp(ref->id, p->id) != 0)) {
+        p->pred = ref->id;
+        p->pred_rank = ref->rang;
+    }
+    if (ref->rang == p->pred_rank) p->nouvelles_pred = MPI_Wtime();
+
+    char *tampon = controle_tampon(envois, ref->rang);
+    Voisinage *v = (Voisinage *)(tampon + sizeof(EnteteControle));
+    memset(v, 0, sizeof(Voisinage));
+    v->id = p->id;
+    v->rang = p->rang;
+    v->pred = p->pred;
+    v->pred_rank = p->pred_rank;
+    v->nb_successeurs = p->nb_successeurs;
+    memcpy(v->successeurs, p->successeurs, sizeof(v->successeurs));
+    memcpy(v->successeurs_rank, p->successeurs_rank, sizeof(v->successeurs_rank));
+    int *suspects = (int *)(v + 1);
+    for (int r = 1; r < envois->nb_rangs && v->nb_suspects < h->nb_suspects; r++) {
+        if (h->suspects[r]) suspects[v->nb_suspects++] = r;
+    }
+    moteur_envoyer(envois->moteur, tampon, sizeof(EnteteControle) + sizeof(Voisinage) + v->nb_suspects * sizeof(int),
+                   numero_rang(ref->rang), TAG_SUCCESSEURS, NULL);
+}
+
+// Réponse du successeur : adopte son prédécesseur s'il s'est intercalé, puis reconstruit la liste
+void stab_reponse(Hote *h, Pair *p, const Voisinage *v) {
+    // Un rang suspecté par le successeur dont on n'a rien reçu depuis un délai de maintenance l'est aussi
+    const int *suspects = (const int *)(v + 1);
+    double maintenant = MPI_Wtime();
+    for (int k = 0; k < v->nb_suspects; k++) {
+        if (maintenant - h->entendus[suspects[k]] > MAINTENANCE_DELAI * h->periode * h->nb_membres) {
+            suspecter(h, (suspects[k] - 1) * nb_virtuels + 1);
+        }
+    }
+
+    if (v->rang != p->finger_table_rank[0]) return;
+    p->attente_succ = 0;
+
+    int ancien = p->finger_table_rank[0];
+    p->nb_successeurs = 0;
+    if (v->pred_rank != 0 && v->pred_rank != p->rang && !suspect(h, v->pred_rank)
+            && cle_dans_intervalle(v->pred, p->id, v->id) && cle_cmp(v->pred, v->id) != 0) {
+        p->finger_table[0] = v->pred;
+        p->finger_table_rank[0] = v->pred_rank;
+        p->successeurs[p->nb_successeurs] = v->pred;
+        p->successeurs_rank[p->nb_successeurs++] = v->pred_rank;
+    }
+    p->successeurs[p->nb_successeurs] = v->id;
+    p->successeurs_rank[p->nb_successeurs++] = v->rang;
+    for (int k = 0; k < v->nb_successeurs && p->nb_successeurs < NB_SUCCESSEURS; k++) {
+        // Sur un petit anneau la liste revient au pair lui même
+        if (v->successeurs_rank[k] == p->rang) break;
+        p->successeurs[p->nb_successeurs] = v->successeurs[k];
+        p->successeurs_rank[p->nb_successeurs++] = v->successeurs_rank[k];
+    }
+    if (p->finger_table_rank[0] != ancien) {
+        char tmp[CLE_STR], tmp2[CLE_STR];
+        TRACE(TRACE_DEBUG, "Pair %s : nouveau successeur %s.\n", cle_str(p->id, tmp), cle_str(p->finger_table[0], tmp2));
+    }
+}
+
+// Entrée i de la finger table de p trouvée par fix_fingers
+void stab_finger(Hote *h, const Requete *rep) {
+    Pair *p = &h->pairs[rep->req_id / M];
+    int i = rep->req_id % M;
+    if (i > 0 && !suspect(h, rep->rang_responsable)) {
+        p->finger_table[i] = rep->responsable;
+        p->finger_table_rank[i] = rep->rang_responsable;
+    }
+}
+
+// Tour de maintenance du pair p
+void maintenance_tour(Hote *h, Pair *p, Envois *envois, double maintenant) {
+    // Chaque pair virtuel n'a un tour que toutes les nb_membres périodes
+    double delai = MAINTENANCE_DELAI * h->periode * h->nb_membres;
+
+    // Successeur muet : le suivant de la liste qui répond le remplace
+    if (p->attente_succ > 0 && maintenant - p->attente_succ > delai) {
+        suspecter(h, p->finger_table_rank[0]);
+        p->attente_succ = 0;
+    }
+    if (suspect(h, p->finger_table_rank[0])) {
+        successeur_vivant(h, p, &p->finger_table[0], &p->finger_table_rank[0]);
+    }
+
+    // Prédécesseur muet : oublié, le prochain pair qui se présente le remplace
+    if (p->pred_rank != 0 && p->pred_rank != p->rang && maintenant - p->nouvelles_pred > delai) {
+        suspecter(h, p->pred_rank);
+        p->pred_rank = 0;
+    }
+
+    if (p->finger_table_rank[0] != p->rang && p->attente_succ == 0) {
+        RefFinger moi = { p->id, p->rang, -1 };
+        envoyer_controle(envois, &moi, sizeof(RefFinger), p->finger_table_rank[0], TAG_STABILISER);
+        p->attente_succ = maintenant;
+    }
+
+    // fix_fingers, l'entrée 0 étant tenue par la stabilisation
+    int i = p->finger_suivant;
+    p->finger_suivant = (i + 1) % M;
+    if (i > 0) {
+        Requete req;
+        memset(&req, 0, sizeof(Requete));
+        req.req_id = numero_virtuel(p->rang) * M + i;
+        req.origine = h->rang;
+        req.rang_entree = h->rang;
+        req.op = TAG_STABILISER;
+        req.key = cle_ajoute_puissance2(p->id, i);
+        lookup(h, &req, envois);
+    }
+}
+
+// Lance le tour de maintenance du pair virtuel suivant quand la période est écoulée
+// Le tour modifie l'état des pairs : les tâches des ouvriers sont terminées avant
+void maintenance(Hote *h, Pool *pool, Envois *envois) {
+    double maintenant = MPI_Wtime();
+    if (maintenant < h->prochain_tour || h->nb_membres == 0) return;
+    h->prochain_tour = maintenant + h->periode;
+    int v = h->membres[h->tour++ % h->nb_membres];
+    if (v == h->joignant) return;
+    if (pool != NULL) pool_attendre(pool);
+    maintenance_tour(h, &h->pairs[v], envois, maintenant);
+}
+
+static int double_cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Affiche moyenne, médiane, p99 et max du nombre de sauts et de la latence des lookups
+// ainsi que l'histogramme du nombre de sauts
+void afficher_benchmark(const int *hops, double *latences, int nb_requetes, int num_pairs) {
+    int max_hops = 0;
+    double somme_hops = 0, somme_latences = 0;
+    for (int i = 0; i < nb_requetes; i++) {
+        if (hops[i] > max_hops) max_hops = hops[i];
+        somme_hops += hops[i];
+        somme_latences += latences[i];
+    }
+
+    int *histogramme = (int *)calloc(max_hops + 1, sizeof(int));
+    double *tri = (double *)malloc(nb_requetes * sizeof(double));
+    for (int i = 0; i < nb_requetes; i++) {
+        histogramme[hops[i]]++;
+        tri[i] = hops[i];
+    }
+    qsort(tri, nb_requetes, sizeof(double), double_cmp);
+    qsort(latences, nb_requetes, sizeof(double), double_cmp);
+    int p50 = nb_requetes / 2;
+    int p99 = (int)(nb_requetes * 0.99);
+    if (p99 >= nb_requetes) p99 = nb_requetes - 1;
+
+    printf("\n************************ BENCHMARK ************************\n");
+    printf("Pairs: %d, lookups: %d, log2(N) = %.2f\n", num_pairs, nb_requetes, log2(num_pairs));
+    printf("Sauts   : moyenne %.2f, p50 %.0f, p99 %.0f, max %d\n",
+           somme_hops / nb_requetes, tri[p50], tri[p99], max_hops);
+    printf("Latence : moyenne %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           1e6 * somme_latences / nb_requetes, 1e6 * latences[p50], 1e6 * latences[p99], 1e6 * latences[nb_requetes-1]);
+    printf("Histogramme des sauts :\n");
+    for (int h = 0; h <= max_hops; h++) {
+        printf("  %3d : %8d (%5.1f%%)\n", h, histogramme[h], 100.0 * histogramme[h] / nb_requetes);
+    }
+
+    free(histogramme);
+    free(tri);
+}
+
+// Charge diffusée par le simulateur vers les pairs
+// preparer remplit l'entête et les données de la requête i envoyée au pair d'indice entree,
+// recevoir traite chaque réponse
+typedef struct {
+    int tag;
+    int nb_requetes;
+    void (*preparer)(void *ctx, int i, int entree, Requete *req, char *donnees);
+    void (*recevoir)(void *ctx, Requete *rep);
+    void *ctx;
+} Charge;
+
+// Suivi d'une charge par le client qui l'émet : le simulateur, ou un rang client avec -l
+typedef struct {
+    const Charge *charge;
+    Envois *envois;
+    int origine;        // Rang du client
+    int num_pairs;      // Rangs vers lesquels les requêtes sont diffusées
+    int fenetre;
+    int emises;
+    int recues;
+} SuiviCharge;
+
+// Remplit la fenêtre de requêtes en vol, chacune envoyée à un rang tiré au hasard
+static void charge_emettre(SuiviCharge *suivi) {
+    const Charge *charge = suivi->charge;
+    char donnees[DONNEES_MAX];
+    while (suivi->emises < charge->nb_requetes && suivi->emises - suivi->recues < suivi->fenetre) {
+        int random_pair_index = rand() % suivi->num_pairs;
+        Requete req;
+        memset(&req, 0, sizeof(Requete));
+        req.req_id = suivi->emises;
+        req.origine = suivi->origine;
+        req.op = charge->tag;
+        charge->preparer(charge->ctx, suivi->emises, random_pair_index, &req, donnees);
+        lot_ajouter(suivi->envois, charge->tag, random_pair_index + 1, &req, donnees);
+        suivi->emises++;
+    }
+}
+
+// Réponse à une requête de la charge, ou saut suivant d'un lookup itératif que le client contacte
+static void charge_recevoir(SuiviCharge *suivi, int tag, Requete *rep) {
+    if (tag == TAG_REFERENCE) {
+        lot_ajouter(suivi->envois, TAG_LOOKUP, numero_rang(rep->rang_responsable), rep, NULL);
+        return;
+    }
+    suivi->charge->recevoir(suivi->charge->ctx, rep);
+    suivi->recues++;
+}
+
+static void simulateur_reception(void *ctx, int source, int tag, char *donnees, int octets) {
+    SuiviCharge *suivi = (SuiviCharge *)ctx;
+    for (int pos = 0; pos < octets; ) {
+        Requete *rep = (Requete *)(donnees + pos);
+        pos += requete_taille(rep);
+        charge_recevoir(suivi, tag, rep);
+    }
+}
+
+// Diffuse la charge vers des pairs tirés au hasard et collecte les réponses, au plus fenetre requêtes en vol
+// Retourne la durée de la charge
+double simulateur_charge(const Charge *charge, int num_pairs, int fenetre) {
+    Moteur moteur;
+    Envois envois;
+    SuiviCharge suivi = { charge, &envois, 0, num_pairs, fenetre, 0, 0 };
+    moteur_init(&moteur, MPI_COMM_WORLD, simulateur_reception, &suivi);
+    envois_creer(&envois, num_pairs + 1, &moteur);
+
+    double debut = MPI_Wtime();
+
+    while (suivi.recues < charge->nb_requetes) {
+        charge_emettre(&suivi);
+        lots_progresser(&envois);
+
+        // Attend une réponse ou la fin d'un envoi qui libère un lot en attente
+        moteur_progresser(&moteur, 1);
+    }
+
+    double duree = MPI_Wtime() - debut;
+    envois_liberer(&envois);
+    moteur_liberer(&moteur);
+    return duree;
+}
+
+// Nombre de clés distinctes d'une charge de lookups biaisée (-z)
+#define ZIPF_CLES 65536
+
+// Charge de lookups, les sauts et latences ne sont conservés qu'en mode benchmark ou par un rang client
+// La clé et le responsable de chaque requête le sont toujours, pour vérifier les réponses à la fin
+typedef struct {
+    const cle_t *identifiers;
+    unsigned graine;
+    int demo;           // Une seule requête dont on affiche le déroulement
+    int *hops;
+    double *latences;
+    cle_t *cles;
+    cle_t *responsables;
+    double *zipf;       // Répartition cumulée des ZIPF_CLES clés, NULL pour des clés toutes différentes
+    int premiere;       // Numéro de la première requête, les clés d'un rang client suivent celles des précédents
+    int iteratif;
+} ChargeLookup;
+
+// Charge de lookups confiée par le simulateur à un rang client (-l)
+typedef struct {
+    int premiere;
+    int nb_requetes;
+    int fenetre;
+    int num_pairs;
+    int iteratif;
+    unsigned graine;
+    double zipf;
+} DemandeClient;
+
+// Bilan d'un rang client, suivi des nb_requetes sauts (int), des nb_requetes latences (double), puis des
+// nb_requetes clés et nb_requetes responsables (cle_t)
+typedef struct {
+    int nb_requetes;
+    double duree;
+} BilanClient;
+
+// Répartition cumulée d'une loi de Zipf d'exposant s sur ZIPF_CLES clés : la clé de rang k est tirée
+// avec une probabilité proportionnelle à 1 / k^s
+double *zipf_repartition(double s) {
+    double *cumul = (double *)malloc(ZIPF_CLES * sizeof(double));
+    double somme = 0;
+    for (int k = 0; k < ZIPF_CLES; k++) {
+        somme += pow(k + 1, -s);
+        cumul[k] = somme;
+    }
+    for (int k = 0; k < ZIPF_CLES; k++) {
+        cumul[k] /= somme;
+    }
+    return cumul;
+}
+
+// Tire le rang d'une clé selon la répartition cumulée
+static int zipf_tirer(const double *cumul) {
+    double u = (double)rand() / ((double)RAND_MAX + 1);
+    int a = 0, b = ZIPF_CLES - 1;
+    while (a < b) {
+        int m = (a + b) / 2;
+        if (cumul[m] > u) {
+            b = m;
+        } else {
+            a = m + 1;
+        }
+    }
+    return a;
+}
+
+static void lookup_preparer(void *ctx, int i, int entree, Requete *req, char *donnees) {
+    ChargeLookup *c = (ChargeLookup *)ctx;
+    char tmp[CLE_STR], tmp2[CLE_STR];
+    // La clé recherchée est le haché de la graine et du numéro de la requête, ou d'un numéro tiré
+    // selon la loi de Zipf pour une charge biaisée
+    unsigned valeur[2] = { c->graine, (unsigned)(c->zipf != NULL ? zipf_tirer(c->zipf) : c->premiere + i) };
+    req->key = hash_cle(valeur, sizeof(valeur));
+    req->iteratif = c->iteratif;
+    if (c->demo && nb_virtuels == 1) {
+        printf("Simulateur: Recherche de la clé %s par le pair d'ID %s.\n\n",
+               cle_str(req->key, tmp), cle_str(c->identifiers[entree], tmp2));
+    } else if (c->demo) {
+        printf("Simulateur: Recherche de la clé %s par le rang %d.\n\n", cle_str(req->key, tmp), entree + 1);
+    }
+    if (c->latences != NULL) {
+        c->latences[i] = MPI_Wtime();
+    }
+}
+
+static void lookup_recevoir(void *ctx, Requete *rep) {
+    ChargeLookup *c = (ChargeLookup *)ctx;
+    char tmp[CLE_STR], tmp2[CLE_STR];
+    if (c->demo) {
+        printf("\nLe pair responsable de la clé %s est le pair avec l'ID %s.\n\n",
+               cle_str(rep->key, tmp), cle_str(rep->responsable, tmp2));
+    }
+    if (c->hops != NULL) {
+        c->hops[rep->req_id] = rep->hops;
+        c->latences[rep->req_id] = MPI_Wtime() - c->latences[rep->req_id];
+    }
+    c->cles[rep->req_id] = rep->key;
+    c->responsables[rep->req_id] = rep->responsable;
+}
+
+// Répartit les lookups entre les rangs 1 à nb_clients, qui les émettent en même temps chacun avec sa
+// fenêtre, et rassemble leurs sauts, latences, clés et responsables ; retourne la durée du client le plus lent
+double simulateur_clients(const DemandeClient *d, int nb_clients, const ChargeLookup *c) {
+    for (int k = 0; k < nb_clients; k++) {
+        DemandeClient part = *d;
+        part.premiere = (int)((long)d->nb_requetes * k / nb_clients);
+        part.nb_requetes = (int)((long)d->nb_requetes * (k + 1) / nb_clients) - part.premiere;
+        stats_send(&part, sizeof(DemandeClient), MPI_BYTE, k + 1, TAG_CLIENT, MPI_COMM_WORLD);
+    }
+
+    double duree = 0;
+    for (int k = 0; k < nb_clients; k++) {
+        MPI_Status status;
+        int octets;
+        MPI_Probe(MPI_ANY_SOURCE, TAG_CLIENT, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_BYTE, &octets);
+        char *tampon = (char *)malloc(octets);
+        stats_recv(tampon, octets, MPI_BYTE, status.MPI_SOURCE, TAG_CLIENT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        BilanClient *bilan = (BilanClient *)tampon;
+        int premiere = (int)((long)d->nb_requetes * (status.MPI_SOURCE - 1) / nb_clients);
+        int n = bilan->nb_requetes;
+        char *pos = tampon + sizeof(BilanClient);
+        memcpy(c->hops + premiere, pos, n * sizeof(int));
+        pos += n * sizeof(int);
+        memcpy(c->latences + premiere, pos, n * sizeof(double));
+        pos += n * sizeof(double);
+        memcpy(c->cles + premiere, pos, n * sizeof(cle_t));
+        memcpy(c->responsables + premiere, pos + n * sizeof(cle_t), n * sizeof(cle_t));
+        if (bilan->duree > duree) duree = bilan->duree;
+        free(tampon);
+    }
+    return duree;
+}
+
+// Simulateur : diffuse la charge de lookups vers les pairs et collecte les réponses
+// Avec nb_clients > 0 ce sont les rangs 1 à nb_clients qui émettent les lookups
+// En mode benchmark le nombre de sauts et la latence de chaque requête sont conservés
+// Le responsable de chaque réponse est vérifié sur l'anneau complet de nb_total pairs, après la mesure
+// Retourne la durée des lookups
+double simulateur_lookups(const cle_t *identifiers, int nb_total, const DemandeClient *d, int benchmark,
+                          int nb_clients) {
+    int nb_requetes = d->nb_requetes;
+    ChargeLookup c = { identifiers, d->graine, nb_requetes == 1 && nb_clients == 0, NULL, NULL, NULL, NULL, NULL, 0, d->iteratif };
+    if (benchmark || nb_clients > 0) {
+        c.hops = (int *)malloc(nb_requetes * sizeof(int));
+        c.latences = (double *)malloc(nb_requetes * sizeof(double));
+    }
+    c.cles = (cle_t *)malloc(nb_requetes * sizeof(cle_t));
+    c.responsables = (cle_t *)malloc(nb_requetes * sizeof(cle_t));
+
+    double duree;
+    if (nb_clients > 0) {
+        duree = simulateur_clients(d, nb_clients, &c);
+    } else {
+        if (d->zipf > 0) c.zipf = zipf_repartition(d->zipf);
+        Charge charge = { TAG_LOOKUP, nb_requetes, lookup_preparer, lookup_recevoir, &c };
+        duree = simulateur_charge(&charge, d->num_pairs, d->fenetre);
+        free(c.zipf);
+    }
+
+    cle_t *ids_tries = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    int *rangs_tries = (int *)malloc(nb_total * sizeof(int));
+    trier_identifiants(identifiers, nb_total, ids_tries, rangs_tries);
+    int faux = 0;
+    for (int i = 0; i < nb_requetes; i++) {
+        faux += !cle_egal(c.responsables[i], ids_tries[successeur_trie(ids_tries, nb_total, c.cles[i])]);
+    }
+
+    if (nb_requetes > 1) {
+        printf("Simulateur: %d lookups %s en %.3f s, soit %.0f lookups/s (%d client%s, fenêtre de %d), %d responsables erronés.\n",
+               nb_requetes, d->iteratif ? "itératifs" : "récursifs", duree, nb_requetes / duree,
+               nb_clients > 0 ? nb_clients : 1, nb_clients > 1 ? "s" : "", d->fenetre, faux);
+    } else if (faux > 0) {
+        printf("Simulateur: responsable erroné.\n");
+    }
+    if (benchmark) {
+        afficher_benchmark(c.hops, c.latences, nb_requetes, d->num_pairs * nb_virtuels);
+    }
+    free(c.hops);
+    free(c.latences);
+    free(c.cles);
+    free(c.responsables);
+    free(ids_tries);
+    free(rangs_tries);
+    return duree;
+}
+
+/********** ACCES DISTANTS **********/
+
+// Avec -o chaque rang expose dans une fenêtre MPI l'id et la finger table de ses pairs virtuels. Tous les
+// rangs restent dans une époque passive (MPI_Win_lock_all) jusqu'à la fin
+// Le simulateur fait alors lui même le parcours de chaque lookup : il lit la table d'un pair, choisit le
+// finger suivant avec find_next et lit la table de ce finger, jusqu'à ce que la clé tombe entre un pair
+// et son successeur. Les pairs intermédiaires ne font aucun calcul. Si tous les rangs sont sur le même
+// nœud, la fenêtre est partagée (MPI_Win_allocate_shared) et une lecture est une simple copie mémoire
+// Les joins et la maintenance modifient les tables pendant les lectures : chaque pair publie les siennes
+// dans deux tampons utilisés à tour de rôle, et une lecture n'est gardée que si la version publiée n'a pas
+// changé pendant qu'elle se faisait
 
-// Structure qui contient les informations d'initialisation pour un pair
+// Crée la fenêtre, collectivement sur MPI_COMM_WORLD ; le simulateur n'expose rien
+void fenetre_creer(int rank, int size, Fenetre *f) {
+    MPI_Comm noeud;
+    int taille_noeud;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &noeud);
+    MPI_Comm_size(noeud, &taille_noeud);
+    MPI_Comm_free(&noeud);
+
+    MPI_Aint octets = rank == 0 ? 0 : nb_virtuels * sizeof(FenetrePair);
+    f->partagee = taille_noeud == size;
+    f->partages = NULL;
+    if (f->partagee) {
+        MPI_Win_allocate_shared(octets, 1, MPI_INFO_NULL, MPI_COMM_WORLD, &f->pairs, &f->win);
+        if (rank == 0) {
+            f->partages = (FenetrePair **)malloc(size * sizeof(FenetrePair *));
+            for (int r = 1; r < size; r++) {
+                MPI_Aint taille;
+                int unite;
+                MPI_Win_shared_query(f->win, r, &taille, &unite, &f->partages[r]);
+            }
+        }
+    } else {
+        MPI_Win_allocate(octets, 1, MPI_INFO_NULL, MPI_COMM_WORLD, &f->pairs, &f->win);
+    }
+    if (octets > 0) memset(f->pairs, 0, octets);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, f->win);
+}
+
+void fenetre_liberer(Fenetre *f) {
+    MPI_Win_unlock_all(f->win);
+    MPI_Win_free(&f->win);
+    free(f->partages);
+}
+
+// Publie les tables des pairs du rang qui ont changé depuis leur dernière publication
+// La table de la version v + 1 est écrite dans le tampon que la version v n'utilise pas, puis la version
+// est remplacée de façon atomique : par MPI_Accumulate, ou par une écriture atomique si la fenêtre est
+// partagée. Le tampon de la version v n'est réécrit qu'une fois la version v + 1 publiée
+void fenetre_publier(Hote *h) {
+    Fenetre *f = h->fenetre;
+    for (int v = 0; v < nb_virtuels; v++) {
+        Pair *p = &h->pairs[v];
+        FenetrePair *fp = &f->pairs[v];
+        const TablePubliee *courante = &fp->tables[p->version & 1];
+        if (p->version > 0 && memcmp(courante->finger_table, p->finger_table, M * sizeof(cle_t)) == 0
+                && memcmp(courante->finger_table_rank, p->finger_table_rank, M * sizeof(int)) == 0) {
+            continue;
+        }
+        TablePubliee *suivante = &fp->tables[(p->version + 1) & 1];
+        memcpy(suivante->finger_table, p->finger_table, M * sizeof(cle_t));
+        memcpy(suivante->finger_table_rank, p->finger_table_rank, M * sizeof(int));
+        suivante->id = p->id;
+        p->version++;
+        MPI_Win_sync(f->win);
+        if (f->partagee) {
+            __atomic_store_n(&fp->version, p->version, __ATOMIC_RELEASE);
+            // Le tampon réécrit par la publication suivante ne doit pas être visible avant la version
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+        } else {
+            MPI_Aint deplacement = (MPI_Aint)v * sizeof(FenetrePair) + offsetof(FenetrePair, version);
+            MPI_Accumulate(&p->version, 1, MPI_INT64_T, h->rang, deplacement, 1, MPI_INT64_T, MPI_REPLACE, f->win);
+            MPI_Win_flush(h->rang, f->win);
+        }
+    }
+}
+
+// Lookup en cours de parcours par le simulateur, table est la dernière table lue
 typedef struct {
-    int id;
-    int finger_table[M];
-    int finger_table_rank[M];
-} Infos;
+    int req_id;
+    cle_t key;
+    int numero;         // Pair dont la table est lue
+    int lectures;       // Tables lues, relectures comprises
+    int etape;          // Opération de la lecture en cours : 0 version, 1 tampon, 2 version à nouveau
+    int64_t versions[2]; // Version publiée avant et après la lecture du tampon
+    TablePubliee copie;
+    const TablePubliee *table;
+} Parcours;
 
-// Fonction de hachage simple
-int hash_function(int value, int max_value) {
-    return value % max_value;
+// Au delà, le parcours est interrompu et compté comme une erreur : des tables incohérentes le feraient
+// tourner sans fin
+#define PARCOURS_MAX_LECTURES (2 * M)
+
+// Émet l'opération p->etape de la lecture de la table du pair p->numero, sa requête est rangée dans req
+// MPI n'ordonne les accumulations que sur un même emplacement : la version et le tampon ne se recouvrent
+// pas, chaque opération n'est donc émise qu'une fois la précédente terminée chez le pair visé
+static void parcours_emettre(Parcours *p, const Fenetre *f, MPI_Request *req) {
+    int r = numero_rang(p->numero);
+    MPI_Aint base = (MPI_Aint)numero_virtuel(p->numero) * sizeof(FenetrePair);
+    if (p->etape == 1) {
+        int nb_mots = (int)(sizeof(TablePubliee) / sizeof(int32_t));
+        MPI_Aint tampon = base + offsetof(FenetrePair, tables) + (p->versions[0] & 1) * sizeof(TablePubliee);
+        MPI_Rget_accumulate(NULL, 0, MPI_INT32_T, &p->copie, nb_mots, MPI_INT32_T, r,
+                            tampon, nb_mots, MPI_INT32_T, MPI_NO_OP, f->win, req);
+    } else {
+        MPI_Rget_accumulate(NULL, 0, MPI_INT64_T, &p->versions[p->etape / 2], 1, MPI_INT64_T, r,
+                            base + offsetof(FenetrePair, version), 1, MPI_INT64_T, MPI_NO_OP, f->win, req);
+    }
 }
 
-// Calcul des finger tables
-void calculate_finger_table(int id_p, int *identifiers, int num_pairs, int *finger_table, int *finger_table_rank) {
-    int max_id = 1 << M;  // 2^M, la taille maximale de l'espace d'identifiants
+// Lit la table du pair p->numero
+// Avec une fenêtre partagée la table est copiée sur place, à nouveau tant que la version change pendant la
+// copie. Sinon la lecture est faite en trois MPI_Rget_accumulate sans opération, émis par parcours_emettre
+// l'un après l'autre : la version, le tampon de cette version, puis la version à nouveau. La table est
+// cohérente si les deux versions sont égales
+static void parcours_lire(Parcours *p, const Fenetre *f, MPI_Request *req) {
+    int r = numero_rang(p->numero), v = numero_virtuel(p->numero);
+    if (f->partages != NULL) {
+        const FenetrePair *fp = f->partages[r] + v;
+        int64_t version;
+        do {
+            p->lectures++;
+            MPI_Win_sync(f->win);
+            version = __atomic_load_n(&fp->version, __ATOMIC_ACQUIRE);
+            memcpy(&p->copie, &fp->tables[version & 1], sizeof(TablePubliee));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        } while (__atomic_load_n(&fp->version, __ATOMIC_RELAXED) != version);
+        p->versions[0] = p->versions[1] = 0;
+        return;
+    }
+    p->lectures++;
+    p->etape = 0;
+    parcours_emettre(p, f, req);
+}
 
-    // Parcours chaque entrée de la finger table
-    for (int i = 0; i < M; i++) {
-        // Calcule l'identifiant cible pour cette entrée de la finger table
-        int finger_id = (id_p + (int)pow(2, i)) % max_id;
-
-        int successor = max_id+1;
-        int successor_rank;
-        int minId = max_id+1;
-        int min_rank;
-
-        // Trouve le successeur de finger_id
-        for (int j = 0; j < num_pairs; j++) {
-            // Si l'identifiant du pair est supérieur ou égal à finger_id et inférieur au successeur actuel
-            // On le met à jour
-            if (identifiers[j] >= finger_id && identifiers[j] < successor) {
-                successor = identifiers[j];
-                successor_rank = j+1;
-            }
+// Avance le parcours après la lecture d'une table, retourne 1 s'il est terminé avec le responsable dans *responsable
+static int parcours_avancer(Parcours *p, cle_t *responsable) {
+    if (cle_egal(p->key, p->table->id)) {
+        *responsable = p->table->id;
+        return 1;
+    }
+    int next = find_next(p->table->id, p->table->finger_table, p->key);
+    if (next == -1) {
+        *responsable = p->table->finger_table[0];
+        return 1;
+    }
+    p->numero = p->table->finger_table_rank[next];
+    return 0;
+}
+
+// Lookups par accès distants, avec les mêmes clés que simulateur_lookups et au plus fenetre parcours en
+// vol, dont les lectures se recouvrent ; chaque responsable trouvé est vérifié sur l'anneau complet
+// Les sauts comptés sont les tables lues. Retourne la durée des lookups
+double simulateur_rma(const Fenetre *f, const cle_t *identifiers, int nb_total, const DemandeClient *d, int benchmark) {
+    // Les copies en mémoire partagée ne peuvent pas se recouvrir : un seul parcours à la fois
+    int nb_requetes = d->nb_requetes;
+    int fenetre = f->partages != NULL ? 1 : d->fenetre < nb_requetes ? d->fenetre : nb_requetes;
+    Parcours *parcours = (Parcours *)malloc(fenetre * sizeof(Parcours));
+    MPI_Request *reqs = (MPI_Request *)malloc(fenetre * sizeof(MPI_Request));
+    int *hops = (int *)malloc(nb_requetes * sizeof(int));
+    double *latences = (double *)malloc(nb_requetes * sizeof(double));
+    double *zipf = d->zipf > 0 ? zipf_repartition(d->zipf) : NULL;
+    cle_t *ids_tries = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    int *rangs_tries = (int *)malloc(nb_total * sizeof(int));
+    trier_identifiants(identifiers, nb_total, ids_tries, rangs_tries);
+
+    int emises = 0, terminees = 0, erreurs = 0, interrompus = 0, relectures = 0;
+    long long lectures = 0;
+    for (int w = 0; w < fenetre; w++) {
+        parcours[w].req_id = -1;
+        parcours[w].table = &parcours[w].copie;
+        reqs[w] = MPI_REQUEST_NULL;
+    }
+    double debut = MPI_Wtime();
 
-            // Maj du plus petit successeur
-            if (identifiers[j] < minId) {
-                minId = identifiers[j];
-                min_rank = j+1;
+    while (terminees < nb_requetes) {
+        // Démarre un parcours dans chaque case libre, à partir d'un pair tiré au hasard
+        for (int w = 0; w < fenetre && emises < nb_requetes; w++) {
+            if (parcours[w].req_id >= 0) continue;
+            Parcours *p = &parcours[w];
+            unsigned valeur[2] = { d->graine, (unsigned)(zipf != NULL ? zipf_tirer(zipf) : emises) };
+            p->req_id = emises++;
+            p->key = hash_cle(valeur, sizeof(valeur));
+            p->numero = rand() % nb_total + 1;
+            p->lectures = 0;
+            latences[p->req_id] = MPI_Wtime();
+            parcours_lire(p, f, &reqs[w]);
+        }
+
+        // Avance un parcours dont la lecture est terminée : une copie en mémoire partagée l'est toujours,
+        // sinon ses trois opérations doivent l'être. Le flush garantit que l'opération terminée a été
+        // appliquée chez le pair visé avant que la suivante y soit émise
+        int w = 0;
+        if (f->partages == NULL) {
+            MPI_Waitany(fenetre, reqs, &w, MPI_STATUS_IGNORE);
+            Parcours *p = &parcours[w];
+            if (p->etape < 2) {
+                MPI_Win_flush(numero_rang(p->numero), f->win);
+                p->etape++;
+                parcours_emettre(p, f, &reqs[w]);
+                continue;
             }
         }
-        
-        // Si aucun successeur alors on a fait le tour de l'anneau donc le successeur de finger_id
-        // est le plus petit successeur
-        if (successor == max_id+1) {
-            successor = minId;
-            successor_rank = min_rank;
+        Parcours *p = &parcours[w];
+        cle_t responsable;
+        int fini = 0;
+        if (p->versions[0] != p->versions[1]) {
+            // Une table a été publiée pendant la lecture : elle est refaite
+            relectures++;
+        } else {
+            fini = parcours_avancer(p, &responsable);
+        }
+        if (!fini && p->lectures >= PARCOURS_MAX_LECTURES) {
+            interrompus++;
+        } else if (!fini) {
+            parcours_lire(p, f, &reqs[w]);
+            continue;
+        } else {
+            erreurs += !cle_egal(responsable, ids_tries[successeur_trie(ids_tries, nb_total, p->key)]);
         }
+        latences[p->req_id] = MPI_Wtime() - latences[p->req_id];
+        hops[p->req_id] = p->lectures;
+        lectures += p->lectures;
+        p->req_id = -1;
+        terminees++;
+    }
 
-        // Stock le successeur dans la finger_table
-        finger_table[i] = successor;
-        // Stock le rank du successeur trouvé
-        finger_table_rank[i] = successor_rank;
+    double duree = MPI_Wtime() - debut;
+    size_t octets = f->partages != NULL ? sizeof(TablePubliee) : sizeof(TablePubliee) + 2 * sizeof(int64_t);
+    printf("Simulateur: %d lookups par accès distants (%s) en %.3f s, soit %.0f lookups/s (fenêtre de %d).\n",
+           nb_requetes, f->partages != NULL ? "mémoire partagée" : "MPI_Rget_accumulate", duree, nb_requetes / duree, fenetre);
+    printf("Simulateur: %.2f tables lues par lookup (%zu octets chacune), %d relues, %d responsables erronés dont %d parcours interrompus.\n",
+           (double)lectures / nb_requetes, octets, relectures, erreurs + interrompus, interrompus);
+    if (benchmark) {
+        afficher_benchmark(hops, latences, nb_requetes, nb_total);
     }
+
+    free(parcours);
+    free(reqs);
+    free(hops);
+    free(latences);
+    free(zipf);
+    free(ids_tries);
+    free(rangs_tries);
+    return duree;
 }
 
-// Trouve le plus grand finger possible pour la cle k
-int find_next(int id_p, const int *finger_table, int key) {
-    int rank = -1;
-    int max = -1;
-    for (int i=1; i<M; i++) {
-        // vérification des bornes ]a, b]
-        if (finger_table[i] < id_p) {
-            // Interval normal (a < b)
-            if (finger_table[i] < key && key <= id_p && finger_table[i] > max) {
-                max = finger_table[i];
-                rank = i;
-            }
+// Clé utilisateur associée au numéro i, retourne sa taille
+static int cle_utilisateur(char *buf, unsigned graine, int i) {
+    return snprintf(buf, 64, "cle-%u-%d", graine, i);
+}
+
+// Valeur de taille variable associée au numéro i, retourne sa taille
+static int valeur_utilisateur(char *buf, unsigned graine, int i) {
+    unsigned v[2] = { graine, (unsigned)i };
+    int taille = 1 + (int)(hash64(v, sizeof(v), 1) % (DONNEES_MAX - 64));
+    for (int j = 0; j < taille; j++) {
+        buf[j] = 'a' + (i + j) % 26;
+    }
+    return taille;
+}
+
+// Scénario de stockage : put de toutes les clés, get, del des clés paires puis get à nouveau
+typedef struct {
+    unsigned graine;
+    int etape;          // Tag de l'opération en cours
+    int supprimees;     // Les clés paires ont déjà été supprimées
+    int erreurs;
+} ChargeStockage;
+
+static void stockage_preparer(void *ctx, int i, int entree, Requete *req, char *donnees) {
+    ChargeStockage *c = (ChargeStockage *)ctx;
+    int numero = c->etape == TAG_DEL ? 2 * i : i;
+    req->taille_cle = cle_utilisateur(donnees, c->graine, numero);
+    req->key = hash_cle(donnees, req->taille_cle);
+    if (c->etape == TAG_PUT) {
+        req->taille_valeur = valeur_utilisateur(donnees + req->taille_cle, c->graine, numero);
+    }
+}
+
+// Vérifie le statut de chaque réponse et la valeur rendue par get
+static void stockage_recevoir(void *ctx, Requete *rep) {
+    ChargeStockage *c = (ChargeStockage *)ctx;
+    if (c->etape != TAG_GET) {
+        if (rep->statut != STATUT_OK) c->erreurs++;
+    } else if (c->supprimees && rep->req_id % 2 == 0) {
+        if (rep->statut != STATUT_ABSENT) c->erreurs++;
+    } else {
+        char attendue[DONNEES_MAX];
+        int taille = valeur_utilisateur(attendue, c->graine, rep->req_id);
+        if (rep->statut != STATUT_OK || rep->taille_valeur != taille
+            || memcmp(requete_donnees(rep), attendue, taille) != 0) {
+            c->erreurs++;
+        }
+    }
+}
+
+// Simulateur : déroule les étapes premiere à derniere du scénario de stockage sur nb_cles clés
+// en passant par les num_pairs premiers pairs, retourne le nombre de réponses incorrectes
+int simulateur_stockage(int num_pairs, int nb_cles, int fenetre, unsigned graine, int premiere, int derniere) {
+    const int etapes[4] = { TAG_PUT, TAG_GET, TAG_DEL, TAG_GET };
+    const char *noms[4] = { "put", "get", "del", "get" };
+    ChargeStockage c = { graine, 0, 0, 0 };
+
+    for (int e = premiere; e <= derniere; e++) {
+        c.etape = etapes[e];
+        c.supprimees = e == 3;
+        Charge charge = { etapes[e], etapes[e] == TAG_DEL ? (nb_cles + 1) / 2 : nb_cles,
+                          stockage_preparer, stockage_recevoir, &c };
+        double duree = simulateur_charge(&charge, num_pairs, fenetre);
+        printf("Simulateur: %d %s en %.3f s, soit %.0f opérations/s.\n",
+               charge.nb_requetes, noms[e], duree, charge.nb_requetes / duree);
+    }
+    return c.erreurs;
+}
+
+// Simulateur : fait entrer un à un dans l'anneau les pairs de numéros nb_membres+1 à num_pairs, chacun
+// par un membre tiré au hasard, et affiche le nombre de messages par join comparé à log2(N)^2
+void simulateur_joins(const cle_t *identifiers, int nb_membres, int num_pairs) {
+    int nb_joins = num_pairs - nb_membres;
+    int total[4] = { 0, 0, 0, 0 };
+    int lookups = 0, max_messages = 0;
+    char tmp[CLE_STR], tmp2[CLE_STR], tmp3[CLE_STR], tmp4[CLE_STR];
+
+    for (int r = nb_membres + 1; r <= num_pairs; r++) {
+        int init_rank = 1 + rand() % (r - 1);
+        DemandeJoin demande = { { numero_virtuel(r), 0 }, init_rank };
+        BilanJonction bilan;
+        stats_send(&demande, sizeof(DemandeJoin), MPI_BYTE, numero_rang(r), TAG_JOIN, MPI_COMM_WORLD);
+        stats_recv(&bilan, sizeof(BilanJonction), MPI_BYTE, numero_rang(r), TAG_JOIN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        int messages = 0;
+        for (int e = 0; e < 4; e++) {
+            total[e] += bilan.messages[e];
+            messages += bilan.messages[e];
+        }
+        lookups += bilan.lookups;
+        if (messages > max_messages) max_messages = messages;
+        if (nb_joins <= 16) {
+            printf("Pair %s rejoint l'anneau par %s : pred %s, succ %s, %d messages dont %d lookups de fingers.\n",
+                   cle_str(identifiers[r-1], tmp), cle_str(identifiers[init_rank-1], tmp2),
+                   cle_str(bilan.pred, tmp3), cle_str(bilan.succ, tmp4), messages, bilan.lookups);
+        }
+    }
+
+    double log_n = log2(num_pairs);
+    printf("Simulateur: %d joins, %.1f messages par join en moyenne (max %d)\n", nb_joins,
+           (double)(total[0] + total[1] + total[2] + total[3]) / nb_joins, max_messages);
+    printf("  successeur %.1f, raccordement %.1f, finger table %.1f (%.1f lookups sur M = %d), listes inverses %.1f\n",
+           (double)total[0] / nb_joins, (double)total[1] / nb_joins, (double)total[2] / nb_joins,
+           (double)lookups / nb_joins, M, (double)total[3] / nb_joins);
+    printf("  log2(N)^2 = %.1f, M * log2(N) = %.1f\n", log_n * log_n, M * log_n);
+}
+
+// Tours de lookups du scénario de pannes : une réponse ne compte que si elle arrive pendant son tour
+// et désigne le pair vivant qui suit la clé
+#define PANNE_TOURS 40
+
+typedef struct {
+    Envois *envois;
+    int base;               // req_id de la première requête du tour
+    const cle_t *attendus;  // Responsable attendu de chaque requête du tour
+    int recues;
+    int reussies;
+    double derniere;        // Arrivée du dernier message
+} SuiviPannes;
+
+static void pannes_reception(void *ctx, int source, int tag, char *donnees, int octets) {
+    SuiviPannes *suivi = (SuiviPannes *)ctx;
+    suivi->derniere = MPI_Wtime();
+    for (int pos = 0; pos < octets; ) {
+        Requete *rep = (Requete *)(donnees + pos);
+        pos += requete_taille(rep);
+        if (rep->req_id < suivi->base) continue;
+        if (tag == TAG_REFERENCE) {
+            lot_ajouter(suivi->envois, TAG_LOOKUP, numero_rang(rep->rang_responsable), rep, NULL);
+            continue;
+        }
+        suivi->recues++;
+        if (cle_cmp(rep->responsable, suivi->attendus[rep->req_id - suivi->base]) == 0) suivi->reussies++;
+    }
+}
+
+// Scénario de pannes (-x) : nb_pannes rangs tirés au hasard sont réduits au silence, puis des tours de
+// nb_requetes lookups, chacun borné par une durée, mesurent le taux de réussite jusqu'au premier tour
+// entièrement réussi, qui donne le temps de rétablissement de l'anneau
+void simulateur_pannes(const cle_t *identifiers, int num_pairs, int nb_pannes, int nb_requetes, int fenetre,
+                       unsigned graine, int iteratif, double periode) {
+    int nb_total = num_pairs * nb_virtuels;
+    unsigned char *muets = (unsigned char *)calloc(num_pairs + 1, 1);
+    for (int k = 0; k < nb_pannes; k++) {
+        int r;
+        do {
+            r = 1 + rand() % num_pairs;
+        } while (muets[r]);
+        muets[r] = 1;
+    }
+
+    // Les clés des rangs muets reviennent au pair vivant suivant
+    cle_t *vivants = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    int *rangs_vivants = (int *)malloc(nb_total * sizeof(int));
+    int nb_vivants = 0;
+    for (int i = 0; i < nb_total; i++) {
+        if (!muets[numero_rang(i+1)]) vivants[nb_vivants++] = identifiers[i];
+    }
+    trier_identifiants(vivants, nb_vivants, vivants, rangs_vivants);
+    int *entrees = (int *)malloc(num_pairs * sizeof(int));
+    int nb_entrees = 0;
+    for (int r = 1; r <= num_pairs; r++) {
+        if (muets[r]) {
+            stats_send(NULL, 0, MPI_BYTE, r, TAG_PANNE, MPI_COMM_WORLD);
+            printf("Simulateur: le rang %d est réduit au silence.\n", r);
         } else {
-            // Interval qui traverse l'anneau (a > b)
-            if ((finger_table[i] < key || key <= id_p) && finger_table[i] > max) {
-                max = finger_table[i];
-                rank = i;
+            entrees[nb_entrees++] = r;
+        }
+    }
+
+    Moteur moteur;
+    Envois envois;
+    cle_t *attendus = (cle_t *)malloc(nb_requetes * sizeof(cle_t));
+    SuiviPannes suivi = { &envois, 0, attendus, 0, 0, 0 };
+    moteur_init(&moteur, MPI_COMM_WORLD, pannes_reception, &suivi);
+    envois_creer(&envois, num_pairs + 1, &moteur);
+
+    // Un tour dure au plus le temps qu'il faut à la maintenance pour détecter une panne
+    double duree_tour = periode * nb_virtuels * MAINTENANCE_DELAI;
+    if (duree_tour < 0.2) duree_tour = 0.2;
+    double debut = MPI_Wtime();
+    double retabli = -1;
+
+    for (int tour = 0; tour < PANNE_TOURS && retabli < 0; tour++) {
+        suivi.base = tour * nb_requetes;
+        suivi.recues = 0;
+        suivi.reussies = 0;
+        int emises = 0;
+        double debut_tour = MPI_Wtime();
+
+        while (suivi.recues < nb_requetes && MPI_Wtime() - debut_tour < duree_tour) {
+            while (emises < nb_requetes && emises - suivi.recues < fenetre) {
+                Requete req;
+                memset(&req, 0, sizeof(Requete));
+                req.req_id = suivi.base + emises;
+                req.op = TAG_LOOKUP;
+                req.iteratif = iteratif;
+                unsigned valeur[3] = { graine, (unsigned)tour, (unsigned)emises };
+                req.key = hash_cle(valeur, sizeof(valeur));
+                attendus[emises] = vivants[successeur_trie(vivants, nb_vivants, req.key)];
+                lot_ajouter(&envois, TAG_LOOKUP, entrees[rand() % nb_entrees], &req, NULL);
+                emises++;
             }
+            lots_progresser(&envois);
+            if (moteur_progresser(&moteur, 0) == 0) usleep(MAINTENANCE_SOMMEIL_US);
         }
+
+        double t = MPI_Wtime() - debut;
+        printf("Tour %2d à %7.1f ms : %5.1f%% de lookups réussis, %d sans réponse.\n", tour, 1e3 * t,
+               100.0 * suivi.reussies / nb_requetes, nb_requetes - suivi.recues);
+        if (suivi.reussies == nb_requetes) retabli = t;
     }
-    return rank;
-}
 
-// Cherche la cle key dans la DHT
-void lookup(int id_p, const int *finger_table, const int *finger_table_rank, int key) {
-    if (key == id_p) {
-        // Le pair est la cle
-        printf("\t=> Le pair %d possède la clé.\n",id_p);
-        MPI_Send(&id_p, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
+    if (retabli >= 0) {
+        printf("Simulateur: %d rangs en panne, anneau rétabli en %.1f ms.\n", nb_pannes, 1e3 * retabli);
     } else {
-        int next = find_next(id_p, finger_table, key);
-        if (next == -1) {
-            // Le successeur possede la cle
-            int succ_p = finger_table[0];
-            printf("\t=> Le successeur de %d possède la clé.\n", id_p);
-            MPI_Send(&succ_p, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
+        printf("Simulateur: %d rangs en panne, anneau non rétabli après %d tours.\n", nb_pannes, PANNE_TOURS);
+    }
+
+    // Les réponses encore en route sont reçues avant la fin : leurs envois doivent se terminer
+    suivi.base = PANNE_TOURS * nb_requetes;
+    suivi.derniere = MPI_Wtime();
+    while (MPI_Wtime() - suivi.derniere < duree_tour) {
+        lots_progresser(&envois);
+        if (moteur_progresser(&moteur, 0) == 0) usleep(MAINTENANCE_SOMMEIL_US);
+    }
+
+    envois_liberer(&envois);
+    moteur_liberer(&moteur);
+    free(attendus);
+    free(entrees);
+    free(vivants);
+    free(rangs_vivants);
+    free(muets);
+}
+
+/********** OUVRIERS **********/
+
+// Avec -t le thread principal d'un pair ne fait que recevoir et traiter les messages de contrôle
+// Les lots de lookups et d'opérations de stockage sont découpés en tâches exécutées par un pool
+// d'ouvriers ; chaque ouvrier envoie ses lots sortants par son propre moteur (MPI_THREAD_MULTIPLE)
+// Les messages de contrôle modifient l'état du pair : ils ne sont traités qu'une fois les tâches
+// en cours terminées, les ouvriers ne lisent donc jamais une finger table en cours de modification
+
+#define REQUETES_PAR_TACHE 64
+
+typedef struct {
+    Hote *hote;
+    Moteur moteur;
+    Envois envois;
+} Ouvrier;
+
+// Lot reçu, partagé par les tâches qui en traitent chacune une partie
+typedef struct {
+    char *donnees;
+    int tag;
+    int restantes;      // Tâches pas encore terminées, la dernière libère le lot
+} LotRecu;
+
+static void ouvrier_traiter(void *ctx, void *arg, int debut, int fin) {
+    Ouvrier *o = (Ouvrier *)ctx;
+    LotRecu *lot = (LotRecu *)arg;
+    for (int pos = debut; pos < fin; ) {
+        Requete *req = (Requete *)(lot->donnees + pos);
+        pos += requete_taille(req);
+        if (lot->tag == TAG_LOOKUP) {
+            lookup(o->hote, req, &o->envois);
+        } else if (lot->tag == TAG_RETOUR) {
+            cache_retour(o->hote, req, &o->envois);
         } else {
-            // Transfer du lookup au finger trouvé
-            printf("\t=> Transfert du lookup au pair %d.\n", finger_table[next]);
-            MPI_Send(&key, 1, MPI_INT, finger_table_rank[next], TAG_LOOKUP, MPI_COMM_WORLD);
-        }   
+            operation_stockage(o->hote, lot->tag, req, &o->envois);
+        }
+    }
+    lots_progresser(&o->envois);
+    moteur_progresser(&o->moteur, 0);
+    if (__atomic_sub_fetch(&lot->restantes, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(lot->donnees);
+        free(lot);
     }
 }
 
-// Vérifie qu'un id n'existe pas déjà dans la liste des identifiants 
-int identifier_exists(int id, int *identifiers, int size) {
-    for (int i = 0; i < size; i++) {
-        if (identifiers[i] == id) {
-            return 1;
+// Sans tâche à traiter l'ouvrier termine l'envoi de ses lots
+static int ouvrier_inactif(void *ctx) {
+    Ouvrier *o = (Ouvrier *)ctx;
+    lots_progresser(&o->envois);
+    moteur_progresser(&o->moteur, 0);
+    return o->envois.nb_attente > 0;
+}
+
+// Copie le lot reçu et le confie au pool par tranches de REQUETES_PAR_TACHE requêtes
+void pool_lot(Pool *pool, int tag, const char *donnees, int octets) {
+    LotRecu *lot = (LotRecu *)malloc(sizeof(LotRecu));
+    lot->donnees = (char *)malloc(octets);
+    memcpy(lot->donnees, donnees, octets);
+    lot->tag = tag;
+    lot->restantes = 0;
+    for (int pos = 0, n = 0; pos < octets; n++) {
+        if (n % REQUETES_PAR_TACHE == 0) lot->restantes++;
+        pos += requete_taille((Requete *)(lot->donnees + pos));
+    }
+
+    // Le compte des tâches est fixé avant la première soumission, qui peut se terminer aussitôt
+    int debut = 0;
+    for (int pos = 0, n = 0; pos < octets; ) {
+        pos += requete_taille((Requete *)(lot->donnees + pos));
+        if (++n % REQUETES_PAR_TACHE == 0 || pos == octets) {
+            pool_soumettre(pool, ouvrier_traiter, lot, debut, pos);
+            debut = pos;
         }
     }
-    return 0;
+}
+
+/********** CLIENTS **********/
+
+// Avec -l les lookups sont émis par des rangs clients plutôt que par le simulateur
+// Un client garde sa fenêtre de requêtes en vol depuis la boucle du rang : les réponses, et en mode
+// itératif les sauts suivants, lui reviennent comme à n'importe quelle origine
+
+typedef struct {
+    ChargeLookup lookups;
+    Charge charge;
+    SuiviCharge suivi;
+    double debut;
+} Client;
+
+Client *client_demarrer(const DemandeClient *d, int rang, Envois *envois) {
+    Client *client = (Client *)calloc(1, sizeof(Client));
+    ChargeLookup *c = &client->lookups;
+    c->graine = d->graine;
+    c->hops = (int *)malloc((d->nb_requetes + 1) * sizeof(int));
+    c->latences = (double *)malloc((d->nb_requetes + 1) * sizeof(double));
+    c->cles = (cle_t *)malloc((d->nb_requetes + 1) * sizeof(cle_t));
+    c->responsables = (cle_t *)malloc((d->nb_requetes + 1) * sizeof(cle_t));
+    if (d->zipf > 0) c->zipf = zipf_repartition(d->zipf);
+    c->premiere = d->premiere;
+    c->iteratif = d->iteratif;
+
+    Charge charge = { TAG_LOOKUP, d->nb_requetes, lookup_preparer, lookup_recevoir, c };
+    client->charge = charge;
+    SuiviCharge suivi = { &client->charge, envois, rang, d->num_pairs, d->fenetre, 0, 0 };
+    client->suivi = suivi;
+    srand(d->graine + rang);
+    client->debut = MPI_Wtime();
+    charge_emettre(&client->suivi);
+    return client;
+}
+
+// Relance la fenêtre ; une fois toutes les réponses reçues, envoie le bilan au simulateur et
+// retourne 1 : le client peut être libéré
+int client_progresser(Client *client) {
+    charge_emettre(&client->suivi);
+    if (client->suivi.recues < client->charge.nb_requetes) return 0;
+
+    int n = client->charge.nb_requetes;
+    int octets = sizeof(BilanClient) + n * (sizeof(int) + sizeof(double) + 2 * sizeof(cle_t));
+    char *tampon = (char *)malloc(octets);
+    BilanClient *bilan = (BilanClient *)tampon;
+    bilan->nb_requetes = n;
+    bilan->duree = MPI_Wtime() - client->debut;
+    char *pos = tampon + sizeof(BilanClient);
+    memcpy(pos, client->lookups.hops, n * sizeof(int));
+    pos += n * sizeof(int);
+    memcpy(pos, client->lookups.latences, n * sizeof(double));
+    pos += n * sizeof(double);
+    memcpy(pos, client->lookups.cles, n * sizeof(cle_t));
+    memcpy(pos + n * sizeof(cle_t), client->lookups.responsables, n * sizeof(cle_t));
+    // Le simulateur attend les bilans, l'envoi peut être bloquant
+    stats_send(tampon, octets, MPI_BYTE, 0, TAG_CLIENT, MPI_COMM_WORLD);
+    free(tampon);
+    return 1;
+}
+
+void client_liberer(Client *client) {
+    free(client->lookups.hops);
+    free(client->lookups.latences);
+    free(client->lookups.cles);
+    free(client->lookups.responsables);
+    free(client->lookups.zipf);
+    free(client);
+}
+
+// Contexte du moteur d'un rang
+typedef struct {
+    Hote *hote;
+    Envois *envois;
+    Pool *pool;         // NULL sans ouvriers
+    Client *client;     // NULL si le rang n'émet pas de lookups
+    int quitter;
+} ServicePair;
+
+// Lance lookup ou l'opération de stockage pour chaque requête du lot reçu
+// Un message de contrôle est traité par le pair virtuel désigné par son entête
+static void pair_reception(void *ctx, int source, int tag, char *donnees, int octets) {
+    ServicePair *service = (ServicePair *)ctx;
+    Hote *h = service->hote;
+    Envois *envois = service->envois;
+
+    // Un rang réduit au silence ignore tout jusqu'au message de terminaison
+    if (h->silencieux && tag != TAG_QUIT) return;
+    if (tag == TAG_PANNE) {
+        h->silencieux = 1;
+        TRACE(TRACE_INFO, "Rang %d : réduit au silence.\n", h->rang);
+        return;
+    }
+    if (h->periode > 0) h->entendus[source] = MPI_Wtime();
+    if (h->nb_suspects > 0 && source != 0 && h->suspects[source]) {
+        if (service->pool != NULL) pool_attendre(service->pool);
+        rehabiliter(h, source);
+    }
+
+    if (service->pool != NULL) {
+        if (tag == TAG_LOOKUP || tag == TAG_PUT || tag == TAG_GET || tag == TAG_DEL || tag == TAG_RETOUR) {
+            pool_lot(service->pool, tag, donnees, octets);
+            return;
+        }
+        // Les réponses d'un client ne touchent pas à l'état des pairs
+        if (tag != TAG_REPONSE && tag != TAG_REFERENCE) pool_attendre(service->pool);
+    }
+
+    if (tag == TAG_QUIT) {
+        // Quitter si message de terminaison
+        service->quitter = 1;
+        return;
+    }
+
+    if (tag == TAG_CLIENT) {
+        service->client = client_demarrer((DemandeClient *)donnees, h->rang, envois);
+        return;
+    }
+
+    // Messages de contrôle du join
+    Pair *p = NULL;
+    RefFinger *ref = NULL;
+    if ((tag >= TAG_JOIN && tag <= TAG_INVERSE) || tag == TAG_STABILISER || tag == TAG_SUCCESSEURS) {
+        p = &h->pairs[((EnteteControle *)donnees)->virtuel];
+        donnees += sizeof(EnteteControle);
+        octets -= sizeof(EnteteControle);
+        ref = (RefFinger *)donnees;
+    }
+
+    switch (tag) {
+        case TAG_JOIN:
+            join_demarrer(h, p, *(int *)donnees, envois);
+            return;
+
+        case TAG_JOIN_PRED:
+            join_accueillir(h, p, ref, envois);
+            return;
+
+        case TAG_JOIN_INFOS:
+            join_infos(h, p, (InfosJonction *)donnees, envois);
+            return;
+
+        case TAG_JOIN_SUCC:
+            // Le nouveau pair devient le successeur
+            p->finger_table[0] = ref->id;
+            p->finger_table_rank[0] = ref->rang;
+            successeurs_devant(p, ref->id, ref->rang);
+            envoyer_controle(envois, NULL, 0, ref->rang, TAG_JOIN_ACK);
+            return;
+
+        case TAG_JOIN_ACK:
+            p->join.messages[1]++;
+            p->join.etape = JOIN_FINGERS;
+            p->join.entree = 1;
+            join_fingers(h, p, envois);
+            return;
+
+        case TAG_MAJ_FINGER:
+            for (int k = 0; k < octets / (int)sizeof(RefFinger); k++) {
+                p->finger_table[ref[k].entree] = ref[k].id;
+                p->finger_table_rank[ref[k].entree] = ref[k].rang;
+            }
+            envoyer_controle(envois, NULL, 0, ref->rang, TAG_MAJ_ACK);
+            return;
+
+        case TAG_MAJ_ACK:
+            p->join.acks_attendus--;
+            return;
+
+        case TAG_INVERSE:
+            for (int k = 0; k < octets / (int)sizeof(RefFinger); k++) {
+                inverse_ajouter(p, &ref[k]);
+            }
+            return;
+
+        case TAG_STABILISER:
+            stab_accueillir(h, p, ref, envois);
+            return;
+
+        case TAG_SUCCESSEURS:
+            stab_reponse(h, p, (Voisinage *)donnees);
+            return;
+    }
+
+    // Les clés transférées ne concernent que le pair dont le join est en cours, comme les réponses
+    // qui ne sont pas destinées au client du rang
+    for (int pos = 0; pos < octets; ) {
+        Requete *req = (Requete *)(donnees + pos);
+        pos += requete_taille(req);
+        if (tag == TAG_LOOKUP) {
+            lookup(h, req, envois);
+        } else if (tag == TAG_REPONSE && req->op == TAG_STABILISER) {
+            if (service->pool != NULL) pool_attendre(service->pool);
+            stab_finger(h, req);
+        } else if (tag == TAG_REFERENCE || (tag == TAG_REPONSE && req->op != TAG_JOIN)) {
+            charge_recevoir(&service->client->suivi, tag, req);
+        } else if (tag == TAG_REPONSE) {
+            if (service->pool != NULL) pool_attendre(service->pool);
+            join_reponse(h, &h->pairs[h->joignant], req, envois);
+        } else if (tag == TAG_RETOUR) {
+            cache_retour(h, req, envois);
+        } else if (tag == TAG_TRANSFERT) {
+            char *cle = requete_donnees(req);
+            stockage_put(&h->stockage[hote_partie(h, req->key)], cle, req->taille_cle,
+                         cle + req->taille_cle, req->taille_valeur);
+            h->pairs[h->joignant].join.transferts_attendus--;
+        } else {
+            operation_stockage(h, tag, req, envois);
+        }
+    }
+
+    if (service->client != NULL && client_progresser(service->client)) {
+        client_liberer(service->client);
+        service->client = NULL;
+    }
+}
+
+// Boucle d'un rang : traite les lots de requêtes reçus jusqu'au message de terminaison
+// Toutes les réceptions et les envois sont complétés par le moteur, le rang ne se bloque que
+// lorsqu'il n'a plus rien à envoyer
+void pair_boucle(Hote *h, int size, int nb_ouvriers) {
+    Moteur moteur;
+    Envois envois;
+    Pool pool;
+    ServicePair service = { h, &envois, nb_ouvriers > 0 ? &pool : NULL, NULL, 0 };
+    moteur_init(&moteur, MPI_COMM_WORLD, pair_reception, &service);
+    envois_creer(&envois, size, &moteur);
+
+    Ouvrier *ouvriers = (Ouvrier *)malloc(nb_ouvriers * sizeof(Ouvrier));
+    void **contextes = (void **)malloc(nb_ouvriers * sizeof(void *));
+    for (int k = 0; k < nb_ouvriers; k++) {
+        ouvriers[k].hote = h;
+        moteur_init(&ouvriers[k].moteur, MPI_COMM_WORLD, NULL, NULL);
+        envois_creer(&ouvriers[k].envois, size, &ouvriers[k].moteur);
+        contextes[k] = &ouvriers[k];
+    }
+    if (nb_ouvriers > 0) pool_demarrer(&pool, nb_ouvriers, contextes, ouvrier_inactif);
+
+    double debut = MPI_Wtime();
+    h->prochain_tour = debut + h->periode;
+    for (int v = 0; v < nb_virtuels; v++) {
+        h->pairs[v].nouvelles_pred = debut;
+    }
+
+    while (!service.quitter) {
+        // Les tables modifiées par les joins et la maintenance sont publiées pour les accès distants
+        if (h->fenetre != NULL) fenetre_publier(h);
+        join_terminer(h, &envois);
+        if (h->periode > 0 && !h->silencieux) maintenance(h, service.pool, &envois);
+        lots_progresser(&envois);
+        if (h->periode == 0) {
+            moteur_progresser(&moteur, 1);
+        } else if (moteur_progresser(&moteur, 0) == 0) {
+            // Avec la maintenance le rang ne se bloque pas : il doit se réveiller à chaque période
+            usleep(MAINTENANCE_SOMMEIL_US);
+        }
+    }
+
+    if (nb_ouvriers > 0) pool_arreter(&pool);
+    for (int k = 0; k < nb_ouvriers; k++) {
+        envois_liberer(&ouvriers[k].envois);
+        moteur_liberer(&ouvriers[k].moteur);
+    }
+    free(ouvriers);
+    free(contextes);
+
+    size_t nb_entrees = 0, arene = 0;
+    for (int k = 0; k < h->nb_parties; k++) {
+        nb_entrees += h->stockage[k].nb_entrees;
+        arene += h->stockage[k].arene_utilise;
+    }
+    TRACE(TRACE_INFO, "Rang %d : %d pairs, %zu clés stockées, arène de %zu octets.\n",
+          h->rang, h->nb_membres, nb_entrees, arene);
+    envois_liberer(&envois);
+    moteur_liberer(&moteur);
+}
+
+// Somme les compteurs des caches vers le rang 0 qui affiche le taux de succès, cache vaut NULL sur le rang 0
+void rapport_cache(const Cache *cache) {
+    long long compteurs[4] = { 0, 0, 0, 0 }, total[4];
+    if (cache != NULL) {
+        compteurs[0] = cache->consultations;
+        compteurs[1] = cache->succes;
+        compteurs[2] = cache->perimees;
+        compteurs[3] = cache->insertions;
+    }
+    stats_collective(4, MPI_LONG_LONG);
+    MPI_Reduce(compteurs, total, 4, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (cache != NULL) return;
+    printf("Cache: %lld consultations, %lld succès (%.1f%%), %lld entrées périmées, %lld insertions.\n",
+           total[0], total[1], total[0] > 0 ? 100.0 * total[1] / total[0] : 0.0, total[2], total[3]);
+}
+
+// Messages de lookup traités par rang, moyenne et maximum affichés par le rang 0 qui passe NULL
+void rapport_charge(const Hote *h) {
+    long long recus = h != NULL ? h->lookups_recus : 0, total, max;
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    stats_collective(2, MPI_LONG_LONG);
+    MPI_Reduce(&recus, &total, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&recus, &max, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (h != NULL) return;
+    double moyenne = (double)total / (size - 1);
+    printf("Charge: %.0f messages de lookup traités par rang en moyenne, %lld au plus (%.2f fois la moyenne).\n",
+           moyenne, max, moyenne > 0 ? max / moyenne : 0.0);
+}
+
+/********** PROXIMITE **********/
+
+// Avec -a un saut vers un rang du même nœud est préféré quand il n'allonge pas la route (saut_proximite)
+// Les nœuds sont ceux de MPI_Comm_split_type(MPI_COMM_TYPE_SHARED), ou des groupes de par_noeud rangs
+// consécutifs pour simuler plusieurs nœuds sur une seule machine
+// Retourne le nœud de chaque rang, désigné par le plus petit rang qu'il héberge
+int *noeuds_calculer(int par_noeud) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int *noeuds = (int *)malloc(size * sizeof(int));
+    if (par_noeud > 0) {
+        // Le simulateur forme un nœud à lui seul
+        noeuds[0] = 0;
+        for (int r = 1; r < size; r++) {
+            noeuds[r] = 1 + (r - 1) / par_noeud * par_noeud;
+        }
+        return noeuds;
+    }
+
+    MPI_Comm local;
+    int chef;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &local);
+    stats_collective(1, MPI_INT);
+    MPI_Allreduce(&rank, &chef, 1, MPI_INT, MPI_MIN, local);
+    stats_collective(1, MPI_INT);
+    MPI_Allgather(&chef, 1, MPI_INT, noeuds, 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Comm_free(&local);
+    return noeuds;
+}
+
+// Pour chaque pair et chaque entrée i de sa finger table, premier pair après le finger dans son intervalle
+// [id + 2^i, id + 2^(i+1)[ qui est hébergé sur le même nœud, cherché parmi PROXIMITE_CANDIDATS pairs
+// positions donne l'indice de chaque pair dans l'anneau trié
+void calculer_proches(const cle_t *ids_tries, const int *rangs_tries, const int *positions, int nb_pairs,
+                      const int *finger_tables_rank, const int *noeuds, cle_t *proches, int *proches_rank) {
+    memset(proches_rank, 0, nb_pairs * M * sizeof(int));
+    for (int j = 0; j < nb_pairs; j++) {
+        int r = rangs_tries[j];
+        int noeud = noeuds[numero_rang(r)];
+        for (int i = 0; i < M; i++) {
+            // L'intervalle s'arrête au finger suivant, ou au pair lui même pour la dernière entrée
+            int fin = i + 1 < M ? finger_tables_rank[(r-1)*M + i + 1] : r;
+            if (fin == finger_tables_rank[(r-1)*M + i]) continue;
+            int pos = positions[finger_tables_rank[(r-1)*M + i] - 1];
+            for (int k = 0; k < PROXIMITE_CANDIDATS; k++) {
+                pos = (pos + 1) % nb_pairs;
+                if (rangs_tries[pos] == fin || rangs_tries[pos] == r) break;
+                if (noeuds[numero_rang(rangs_tries[pos])] == noeud) {
+                    proches[(r-1)*M + i] = ids_tries[pos];
+                    proches_rank[(r-1)*M + i] = rangs_tries[pos];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Part des lookups transférés qui sont restés sur le nœud, affichée par le rang 0 qui passe NULL
+void rapport_proximite(const Hote *h) {
+    long long sauts[2] = { 0, 0 }, total[2];
+    if (h != NULL) {
+        sauts[0] = h->sauts_noeud;
+        sauts[1] = h->sauts_distants;
+    }
+    stats_collective(2, MPI_LONG_LONG);
+    MPI_Reduce(sauts, total, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (h != NULL) return;
+    long long somme = total[0] + total[1];
+    printf("Proximité: %lld transferts de lookup entre rangs, %lld sur le même nœud (%.1f%%), %lld vers un autre nœud.\n",
+           somme, total[0], somme > 0 ? 100.0 * total[0] / somme : 0.0, total[1]);
 }
 
 int main(int argc, char **argv) {
-    MPI_Status status;
-    MPI_Init(&argc, &argv);
+    // Options : -n nombre de lookups, -w nombre max de requêtes en vol
+    //           -r fichier pour écrire le rapport d'instrumentation en CSV ("-" pour la sortie standard)
+    //           -s graine des identifiants et des clés, -b affiche la distribution des sauts et latences
+    //           -k nombre de clés du scénario put/get/del
+    //           -j nombre de rangs absents de l'anneau initial, dont les pairs le rejoignent un par un
+    //           -t nombre de threads ouvriers par rang, -v nombre de pairs virtuels par rang
+    //           -c nombre d'entrées du cache des responsables de chaque rang, -z exposant de Zipf des clés des lookups
+    //           -i lookups itératifs, -l nombre de rangs clients qui émettent les lookups à la place du simulateur
+    //           -p période de maintenance de l'anneau en ms, -x nombre de rangs mis en panne à la fin
+    //           -a routage par proximité, avec des nœuds de rangs_par_noeud rangs (0 : nœuds réels de MPI)
+    //           -o lookups refaits par accès distants aux finger tables, comparés aux lookups par messages
+    // Elles sont lues avant MPI_Init, qui dépend de -t
+    int nb_requetes = 1;
+    int fenetre = 1024;
+    const char *rapport = NULL;
+    unsigned graine = (unsigned)time(NULL);
+    int benchmark = 0;
+    int nb_cles = 0;
+    int nb_joins = 0;
+    int nb_ouvriers = 0;
+    int taille_cache = 0;
+    double zipf = 0;
+    int iteratif = 0;
+    int nb_clients = 0;
+    double periode = 0;
+    int nb_pannes = 0;
+    int par_noeud = -1;
+    int rma = 0;
+    int usage = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:w:r:s:bk:j:t:v:c:z:il:p:x:a:o")) != -1) {
+        switch (opt) {
+            case 'n': nb_requetes = atoi(optarg); break;
+            case 'w': fenetre = atoi(optarg); break;
+            case 'r': rapport = optarg; break;
+            case 's': graine = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'b': benchmark = 1; break;
+            case 'k': nb_cles = atoi(optarg); break;
+            case 'j': nb_joins = atoi(optarg); break;
+            case 't': nb_ouvriers = atoi(optarg); break;
+            case 'v': nb_virtuels = atoi(optarg); break;
+            case 'c': taille_cache = atoi(optarg); break;
+            case 'z': zipf = atof(optarg); break;
+            case 'i': iteratif = 1; break;
+            case 'l': nb_clients = atoi(optarg); break;
+            case 'p': periode = atof(optarg) / 1000; break;
+            case 'x': nb_pannes = atoi(optarg); break;
+            case 'a': par_noeud = atoi(optarg); break;
+            case 'o': rma = 1; break;
+            default: usage = 1; break;
+        }
+    }
+
+    // Les ouvriers appellent MPI en même temps que le thread principal
+    int niveau = MPI_THREAD_SINGLE;
+    if (nb_ouvriers > 0) {
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &niveau);
+    } else {
+        MPI_Init(&argc, &argv);
+    }
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     int num_pairs = size - 1; 
+    trace_init(rank);
+    cle_init_mpi();
+    infos_types_creer();
+
+    if (usage || nb_ouvriers < 0 || nb_virtuels < 1 || taille_cache < 0 || zipf < 0 || nb_clients < 0 || nb_clients > num_pairs
+            || periode < 0 || nb_pannes < 0 || nb_pannes >= num_pairs || par_noeud < -1) {
+        if (rank == 0) fprintf(stderr, "Usage: %s [-n nb_lookups] [-w fenetre] [-s graine] [-b] [-k nb_cles] [-j nb_joins] [-t nb_ouvriers] [-v nb_virtuels] [-c taille_cache] [-z exposant] [-i] [-l nb_clients] [-p periode_ms] [-x nb_pannes] [-a rangs_par_noeud] [-o] [-r rapport.csv]\n", argv[0]);
+        trace_vider();
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (nb_ouvriers > 0 && niveau < MPI_THREAD_MULTIPLE) {
+        if (rank == 0) fprintf(stderr, "Attention: MPI_THREAD_MULTIPLE non disponible, les pairs n'utilisent pas d'ouvriers\n");
+        nb_ouvriers = 0;
+    }
+
+    // L'espace d'identifiants doit pouvoir accueillir tous les pairs
+#if M < 31
+    if ((long)num_pairs * nb_virtuels > (1L << M)) {
+        if (rank == 0) fprintf(stderr, "Erreur: %d pairs pour un espace de 2^%d identifiants\n", num_pairs * nb_virtuels, M);
+        trace_vider();
+        MPI_Finalize();
+        return 1;
+    }
+#endif
+
+    // L'anneau initial doit compter au moins un pair
+    int nb_membres = num_pairs - nb_joins;
+    if (nb_joins < 0 || nb_membres < 1) {
+        if (rank == 0) fprintf(stderr, "Erreur: %d joins pour %d pairs\n", nb_joins, num_pairs);
+        trace_vider();
+        MPI_Finalize();
+        return 1;
+    }
+
+    stats_nommer_tag(TAG_INIT, "TAG_INIT");
+    stats_nommer_tag(TAG_LOOKUP, "TAG_LOOKUP");
+    stats_nommer_tag(TAG_QUIT, "TAG_QUIT");
+    stats_nommer_tag(TAG_REPONSE, "TAG_REPONSE");
+    stats_nommer_tag(TAG_PUT, "TAG_PUT");
+    stats_nommer_tag(TAG_GET, "TAG_GET");
+    stats_nommer_tag(TAG_DEL, "TAG_DEL");
+    stats_nommer_tag(TAG_JOIN, "TAG_JOIN");
+    stats_nommer_tag(TAG_JOIN_PRED, "TAG_JOIN_PRED");
+    stats_nommer_tag(TAG_JOIN_INFOS, "TAG_JOIN_INFOS");
+    stats_nommer_tag(TAG_JOIN_SUCC, "TAG_JOIN_SUCC");
+    stats_nommer_tag(TAG_JOIN_ACK, "TAG_JOIN_ACK");
+    stats_nommer_tag(TAG_MAJ_FINGER, "TAG_MAJ_FINGER");
+    stats_nommer_tag(TAG_MAJ_ACK, "TAG_MAJ_ACK");
+    stats_nommer_tag(TAG_INVERSE, "TAG_INVERSE");
+    stats_nommer_tag(TAG_TRANSFERT, "TAG_TRANSFERT");
+    stats_nommer_tag(TAG_RETOUR, "TAG_RETOUR");
+    stats_nommer_tag(TAG_REFERENCE, "TAG_REFERENCE");
+    stats_nommer_tag(TAG_CLIENT, "TAG_CLIENT");
+    stats_nommer_tag(TAG_STABILISER, "TAG_STABILISER");
+    stats_nommer_tag(TAG_SUCCESSEURS, "TAG_SUCCESSEURS");
+    stats_nommer_tag(TAG_PANNE, "TAG_PANNE");
+    stats_nommer_phase(PHASE_INIT, "initialisation");
+    stats_nommer_phase(PHASE_LOOKUP, "lookup");
+    stats_nommer_phase(PHASE_STOCKAGE, "stockage");
+    stats_nommer_phase(PHASE_JOIN, "join");
+    stats_nommer_phase(PHASE_PANNE, "panne");
+    stats_nommer_phase(PHASE_RMA, "lookup_rma");
 
-    int id_p;
-    int succ_p;
-    int *identifiers = NULL;
-    int *finger_table = NULL;
-    int *finger_table_rank = NULL;
+    Hote hote;
+    cle_t *identifiers = NULL;
     Infos infos;
 
+    // Avec -v chaque rang héberge nb_virtuels pairs, numérotés de 1 à nb_total
+    int nb_total = num_pairs * nb_virtuels;
+    int nb_initiaux = nb_membres * nb_virtuels;
+
     /********** INITIALISATION **********/
+    stats_phase_debut(PHASE_INIT);
+    int *noeuds = par_noeud >= 0 ? noeuds_calculer(par_noeud) : NULL;
+
+    // Avec -o les finger tables des pairs sont rangées dans la fenêtre
+    Fenetre fenetre_rma;
+    if (rma) fenetre_creer(rank, size, &fenetre_rma);
     if (rank == 0) {
         printf("******************** INITIALISATION ********************\n");
 
-        identifiers = (int *)malloc(num_pairs * sizeof(int));
+        identifiers = (cle_t *)malloc(nb_total * sizeof(cle_t));
+        cle_t *ids_tries = (cle_t *)malloc(nb_total * sizeof(cle_t));
+        int *rangs_tries = (int *)malloc(nb_total * sizeof(int));
+        cle_t *predecesseurs = (cle_t *)malloc(nb_total * sizeof(cle_t));
+        int *predecesseurs_rank = (int *)malloc(nb_total * sizeof(int));
+        cle_t *finger_tables = (cle_t *)malloc(nb_total * M * sizeof(cle_t));
+        int *finger_tables_rank = (int *)malloc(nb_total * M * sizeof(int));
+        char tmp[CLE_STR];
 
         // Initialisation des identifiants des pairs
-        srand(time(NULL));
-        for (int i = 0; i < num_pairs; i++) {
-            int id;
-            do {
-                id = hash_function(rand(), 1 << M);
-            } while (identifier_exists(id, identifiers, i));
-            identifiers[i] = id;
-        }
+        srand(graine);
+        generer_identifiants(identifiers, nb_total, ids_tries, rangs_tries);
 
         // Affichage des identifiants
         printf("Simulateur: Identifiants des pairs = [ ");
-        for (int i = 0; i < num_pairs; i++) {
-            printf("%d ", identifiers[i]);
+        for (int i = 0; i < nb_total; i++) {
+            printf("%s ", cle_str(identifiers[i], tmp));
         }
         printf("]\n");
 
-        // Calcul et envoi des finger tables et des ids
-        for(int i = 0; i < num_pairs; i++) {
+        // Seuls les pairs des nb_membres premiers rangs forment l'anneau initial
+        trier_identifiants(identifiers, nb_initiaux, ids_tries, rangs_tries);
+
+        // Le prédécesseur de chaque pair borne l'intervalle des clés qu'il stocke
+        int *positions = (int *)malloc(nb_total * sizeof(int));
+        for (int j = 0; j < nb_initiaux; j++) {
+            predecesseurs[rangs_tries[j]-1] = ids_tries[(j - 1 + nb_initiaux) % nb_initiaux];
+            predecesseurs_rank[rangs_tries[j]-1] = rangs_tries[(j - 1 + nb_initiaux) % nb_initiaux];
+            positions[rangs_tries[j]-1] = j;
+        }
+
+        // Part de l'anneau dont chaque rang est responsable : les pairs virtuels l'équilibrent
+        double *parts = (double *)calloc(num_pairs + 1, sizeof(double));
+        double part_max = 0;
+        for (int j = 0; j < nb_initiaux; j++) {
+            cle_t arc = cle_distance(ids_tries[(j - 1 + nb_initiaux) % nb_initiaux], ids_tries[j]);
+            parts[numero_rang(rangs_tries[j])] += nb_initiaux == 1 ? 1.0 : cle_fraction(arc);
+        }
+        for (int r = 1; r <= nb_membres; r++) {
+            if (parts[r] > part_max) part_max = parts[r];
+        }
+        printf("Simulateur: %d pairs virtuels par rang, la plus grande part de l'anneau vaut %.2f fois la moyenne\n",
+               nb_virtuels, part_max * nb_membres);
+        free(parts);
+
+        // Calcul de toutes les finger tables en un balayage de l'anneau trié
+        calculer_finger_tables(ids_tries, rangs_tries, nb_initiaux, finger_tables, finger_tables_rank);
+
+        // Avec -a, remplaçants des fingers sur le même nœud
+        cle_t *proches = NULL;
+        int *proches_rank = NULL;
+        if (noeuds != NULL) {
+            proches = (cle_t *)malloc(nb_total * M * sizeof(cle_t));
+            proches_rank = (int *)malloc(nb_total * M * sizeof(int));
+            calculer_proches(ids_tries, rangs_tries, positions, nb_initiaux, finger_tables_rank, noeuds, proches, proches_rank);
+            int nb_noeuds = 0;
+            for (int r = 1; r < size; r++) {
+                int premier = 1;
+                for (int q = 1; q < r && premier; q++) premier = noeuds[q] != noeuds[r];
+                nb_noeuds += premier;
+            }
+            printf("Simulateur: routage par proximité sur %d nœuds\n", nb_noeuds);
+        }
+
+        // Envoi des finger tables et des ids
+        memset(&infos, 0, sizeof(Infos));
+        for(int i = 0; i < nb_total; i++) {
             infos.id = identifiers[i];
+            infos.membre = i < nb_initiaux;
+            if (infos.membre) {
+                infos.pred = predecesseurs[i];
+                infos.pred_rank = predecesseurs_rank[i];
+                memcpy(infos.finger_table, finger_tables + i*M, M * sizeof(cle_t));
+                memcpy(infos.finger_table_rank, finger_tables_rank + i*M, M * sizeof(int));
 
-            // Calcul de la finger table
-            calculate_finger_table(identifiers[i], identifiers, num_pairs, infos.finger_table, infos.finger_table_rank);
+                // Liste des pairs qui suivent sur l'anneau, sans revenir au pair lui même
+                infos.nb_successeurs = nb_initiaux - 1 < NB_SUCCESSEURS ? nb_initiaux - 1 : NB_SUCCESSEURS;
+                for (int k = 0; k < infos.nb_successeurs; k++) {
+                    infos.successeurs[k] = ids_tries[(positions[i] + k + 1) % nb_initiaux];
+                    infos.successeurs_rank[k] = rangs_tries[(positions[i] + k + 1) % nb_initiaux];
+                }
+                if (proches != NULL) {
+                    memcpy(infos.proches, proches + i*M, M * sizeof(cle_t));
+                    memcpy(infos.proches_rank, proches_rank + i*M, M * sizeof(int));
+                }
 
-            // Affichage des résultats pour chaque pair
-            printf("Pair %d (ID: %d): Finger Table = [ ", i+1, identifiers[i]);
-            for (int i = 0; i < M; i++) {
-                printf("%d ", infos.finger_table[i]);
+                // Affichage des résultats pour chaque pair
+                printf("Pair %d (ID: %s): Finger Table = [ ", i+1, cle_str(identifiers[i], tmp));
+                for (int i = 0; i < M; i++) {
+                    printf("%s ", cle_str(infos.finger_table[i], tmp));
+                }
+                printf("], Successeur = %s\n", cle_str(infos.finger_table[0], tmp));
+            } else {
+                printf("Pair %d (ID: %s): hors de l'anneau, rejoindra par un join\n", i+1, cle_str(identifiers[i], tmp));
             }
-            printf("], Successeur = %d\n", infos.finger_table[0]);
 
             // Envoi de la structure contenant l'id, la finger table et les rangs
-            MPI_Send(&infos, sizeof(Infos), MPI_BYTE, i+1, 0, MPI_COMM_WORLD);
+            stats_send(&infos, 1, infos_type(infos.membre, noeuds != NULL), numero_rang(i+1), TAG_INIT, MPI_COMM_WORLD);
         }
 
-        free(identifiers);
+        // Listes inverses : chaque membre reçoit les entrées de finger table qui le désignent
+        int *nb_inverses = (int *)calloc(nb_initiaux + 1, sizeof(int));
+        for (int k = 0; k < nb_initiaux * M; k++) {
+            nb_inverses[finger_tables_rank[k]]++;
+        }
+        int *debut = (int *)calloc(nb_initiaux + 2, sizeof(int));
+        for (int r = 1; r <= nb_initiaux; r++) {
+            debut[r+1] = debut[r] + nb_inverses[r];
+        }
+        RefFinger *inverses = (RefFinger *)malloc(nb_initiaux * M * sizeof(RefFinger));
+        for (int k = 0; k < nb_initiaux * M; k++) {
+            RefFinger ref = { identifiers[k / M], k / M + 1, k % M };
+            inverses[debut[finger_tables_rank[k]]++] = ref;
+        }
+        for (int r = 1; r <= nb_initiaux; r++) {
+            RefFinger *liste = inverses + debut[r] - nb_inverses[r];
+            stats_send(liste, nb_inverses[r] * sizeof(RefFinger), MPI_BYTE, numero_rang(r), TAG_INIT, MPI_COMM_WORLD);
+        }
+
+        free(nb_inverses);
+        free(debut);
+        free(inverses);
+        free(positions);
+        free(ids_tries);
+        free(rangs_tries);
+        free(predecesseurs);
+        free(predecesseurs_rank);
+        free(finger_tables);
+        free(finger_tables_rank);
+        free(proches);
+        free(proches_rank);
 
     } else {
-        finger_table =  (int *)malloc(M * sizeof(int));
-        finger_table_rank = (int *)malloc(M * sizeof(int));
+        memset(&hote, 0, sizeof(Hote));
+        hote.rang = rank;
+        hote.joignant = -1;
+        hote.pairs = (Pair *)calloc(nb_virtuels, sizeof(Pair));
+        hote.ids_membres = (cle_t *)malloc(nb_virtuels * sizeof(cle_t));
+        hote.membres = (int *)malloc(nb_virtuels * sizeof(int));
+        hote.suspects = (unsigned char *)calloc(size, 1);
+        hote.entendus = (double *)calloc(size, sizeof(double));
+        hote.periode = periode;
+        hote.noeuds = noeuds;
+        hote.fenetre = rma ? &fenetre_rma : NULL;
 
-        // Reception de la structure
-        MPI_Recv(&infos, sizeof(Infos), MPI_BYTE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        // Quelques parties de plus que d'ouvriers pour limiter l'attente sur les verrous
+        int nb_parties = 1;
+        while (nb_parties < 4 * nb_ouvriers) nb_parties *= 2;
+        hote_stockage_init(&hote, nb_parties);
+        cache_init(&hote.cache, taille_cache, nb_parties);
 
-        id_p = infos.id;
-        succ_p = infos.finger_table[0];
+        for (int v = 0; v < nb_virtuels; v++) {
+            Pair *pair = &hote.pairs[v];
+            pair->rang = (rank - 1) * nb_virtuels + v + 1;
+            pair->finger_table = (cle_t *)fingers_allouer(M * sizeof(cle_t));
+            pair->finger_table_rank = (int *)fingers_allouer(M * sizeof(int));
 
-        // Copie les infos reçues dans les tableaux locaux
-        for (int i = 0; i < M; i++) {
-            finger_table[i] = infos.finger_table[i];
-            finger_table_rank[i] = infos.finger_table_rank[i];
+            // Reception de la structure
+            // Seuls les pairs des nb_membres premiers rangs sont dans l'anneau initial
+            memset(&infos, 0, sizeof(Infos));
+            stats_recv(&infos, 1, infos_type(rank <= nb_membres, noeuds != NULL), 0, TAG_INIT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+            pair->id = infos.id;
+            pair->pred = infos.pred;
+            pair->pred_rank = infos.pred_rank;
+
+            // Copie les infos reçues dans les tableaux locaux
+            for (int i = 0; i < M; i++) {
+                pair->finger_table[i] = infos.finger_table[i];
+                pair->finger_table_rank[i] = infos.finger_table_rank[i];
+            }
+            pair->nb_successeurs = infos.nb_successeurs;
+            memcpy(pair->successeurs, infos.successeurs, sizeof(pair->successeurs));
+            memcpy(pair->successeurs_rank, infos.successeurs_rank, sizeof(pair->successeurs_rank));
+            memcpy(pair->proches, infos.proches, sizeof(pair->proches));
+            memcpy(pair->proches_rank, infos.proches_rank, sizeof(pair->proches_rank));
+            if (infos.membre) hote_ajouter_membre(&hote, v);
+        }
+
+        for (int v = 0; v < nb_virtuels && hote.nb_membres > 0; v++) {
+            // Reception de la liste inverse
+            Pair *pair = &hote.pairs[v];
+            MPI_Status status;
+            int octets;
+            MPI_Probe(0, TAG_INIT, MPI_COMM_WORLD, &status);
+            MPI_Get_count(&status, MPI_BYTE, &octets);
+            pair->nb_inverses = pair->cap_inverses = octets / sizeof(RefFinger);
+            pair->inverses = (RefFinger *)malloc(octets > 0 ? octets : 1);
+            stats_recv(pair->inverses, octets, MPI_BYTE, 0, TAG_INIT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         }
+        if (rma) fenetre_publier(&hote);
+    }
+    // Les tables sont publiées avant le premier accès du simulateur
+    if (rma) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Win_sync(fenetre_rma.win);
     }
+    stats_phase_fin(PHASE_INIT);
     /******** FIN INITIALISATION ********/
 
     /************** LOOKUP **************/
     if (rank == 0) {
+        int erreurs = 0;
+
+        // Les clés insérées avant les joins doivent être retrouvées après
+        if (nb_cles > 0) {
+            stats_phase_debut(PHASE_STOCKAGE);
+            printf("\n\n*********************** STOCKAGE ***********************\n");
+            erreurs += simulateur_stockage(nb_membres, nb_cles, fenetre, graine, 0, 0);
+            stats_phase_fin(PHASE_STOCKAGE);
+        }
+
+        if (nb_joins > 0) {
+            stats_phase_debut(PHASE_JOIN);
+            printf("\n\n************************* JOIN *************************\n");
+            simulateur_joins(identifiers, nb_initiaux, nb_total);
+            stats_phase_fin(PHASE_JOIN);
+        }
+
+        stats_phase_debut(PHASE_LOOKUP);
         printf("\n\n************************ LOOKUP ************************\n");
-        // Choisir aléatoirement un identifiant de pair et une clé
-        int random_pair_index = rand() % num_pairs;
-        int random_pair_id = identifiers[random_pair_index];
-        int key_to_find = rand() % (1 << M);
-        printf("Simulateur: Recherche de la clé %d par le pair d'ID %d.\n\n", key_to_find, random_pair_id);
+        DemandeClient demande = { 0, nb_requetes, fenetre, num_pairs, iteratif, graine, zipf };
+        double duree = simulateur_lookups(identifiers, nb_total, &demande, benchmark, nb_clients);
+        stats_phase_fin(PHASE_LOOKUP);
+
+        if (rma) {
+            stats_phase_debut(PHASE_RMA);
+            printf("\n\n***************** LOOKUP PAR ACCES DISTANTS *****************\n");
+            double duree_rma = simulateur_rma(&fenetre_rma, identifiers, nb_total, &demande, benchmark);
+            stats_phase_fin(PHASE_RMA);
+            if (nb_requetes > 1) {
+                printf("Simulateur: débit des accès distants égal à %.2f fois celui des messages.\n", duree / duree_rma);
+            }
+        }
 
-        // Envoyer la requête de recherche au pair sélectionné
-        MPI_Send(&key_to_find, 1, MPI_INT, random_pair_index + 1, TAG_LOOKUP, MPI_COMM_WORLD);
+        if (nb_cles > 0) {
+            stats_phase_debut(PHASE_STOCKAGE);
+            printf("\n\n*********************** STOCKAGE ***********************\n");
+            erreurs += simulateur_stockage(num_pairs, nb_cles, fenetre, graine, 1, 3);
+            stats_phase_fin(PHASE_STOCKAGE);
+            printf("Simulateur: %d erreurs de vérification du stockage.\n", erreurs);
+        }
 
-        // Recevoir le résultat de la recherche
-        int responsible_p;
-        MPI_Recv(&responsible_p, 1, MPI_INT, MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        printf("\nLe pair responsable de la clé %d est le pair avec l'ID %d.\n\n", key_to_find, responsible_p);
+        if (nb_pannes > 0) {
+            stats_phase_debut(PHASE_PANNE);
+            printf("\n\n************************* PANNES *************************\n");
+            simulateur_pannes(identifiers, num_pairs, nb_pannes, nb_requetes, fenetre, graine, iteratif, periode);
+            stats_phase_fin(PHASE_PANNE);
+        }
 
         // Envoyer un message de terminaison à tous les processus
         for (int i = 1; i < size; i++) {
-            int quit = 1;
-            MPI_Send(&quit, 1, MPI_INT, i, TAG_QUIT, MPI_COMM_WORLD);
+            stats_send(NULL, 0, MPI_BYTE, i, TAG_QUIT, MPI_COMM_WORLD);
         }
+        free(identifiers);
 
     } else {
-        int responsible_p;
-        int recv;
-        while (1) {
-            // Boucler sur la reception d'un message
-            MPI_Recv(&recv, 1, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-
-            if (status.MPI_TAG == TAG_QUIT) { 
-                // Quitter si message de terminaison
-                break; 
-
-            } else if (status.MPI_TAG == TAG_LOOKUP) { 
-                // Lancer lookup si message de recherche
-                lookup(id_p, finger_table, finger_table_rank, recv);                
-            }
-
-        }
+        // Les pairs servent joins, lookups et opérations de stockage dans la même boucle
+        stats_phase_debut(PHASE_LOOKUP);
+        pair_boucle(&hote, size, nb_ouvriers);
+        stats_phase_fin(PHASE_LOOKUP);
     }
     /************ FIN LOOKUP ************/
+
+    if (taille_cache > 0) {
+        rapport_cache(rank == 0 ? NULL : &hote.cache);
+    }
+    if (benchmark) {
+        rapport_charge(rank == 0 ? NULL : &hote);
+    }
+    if (noeuds != NULL) {
+        rapport_proximite(rank == 0 ? NULL : &hote);
+    }
+
+    if (rapport != NULL) {
+        stats_rapport(rapport, MPI_COMM_WORLD);
+    }
     
+    if (rma) fenetre_liberer(&fenetre_rma);
     if (rank != 0) {
-        free(finger_table);
-        free(finger_table_rank);
+        for (int v = 0; v < nb_virtuels; v++) {
+            free(hote.pairs[v].finger_table);
+            free(hote.pairs[v].finger_table_rank);
+            free(hote.pairs[v].inverses);
+        }
+        free(hote.pairs);
+        free(hote.ids_membres);
+        free(hote.membres);
+        free(hote.suspects);
+        free(hote.entendus);
+        hote_stockage_liberer(&hote);
+        cache_liberer(&hote.cache);
     }
 
+    free(noeuds);
+    trace_vider();
+    infos_types_liberer();
+    cle_liberer_mpi();
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
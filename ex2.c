@@ -1,255 +1,556 @@
 #include <mpi.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-#define M 5                     // Nombre de bits pour les identifiants
+#include "chord.h"
+#include "instantane.h"
+#include "moteur.h"
+#include "stats.h"
+#include "trace.h"
+
+#define TAG_INIT 0              // Informations envoyées par le simulateur
 #define TAG_ELECTION 1          // Message d'élection
 #define TAG_RET_ELECTION 2      // Retour à l'envoyeur du message d'élection
 #define TAG_LEADER 3            // Annonce du leader
 #define TAG_GETID 4             // Message pour récupérer les id
+#define TAG_FINGERS 5           // Finger tables distribuées par le leader
+
+// Phases mesurées par l'instrumentation
+#define PHASE_INIT 0
+#define PHASE_ELECTION 1
+#define PHASE_COLLECTE 2
+#define PHASE_CALCUL 3
+#define PHASE_DISTRIBUTION 4
+#define PHASE_INSTANTANE 5
+
+// Modes de récupération des id par le leader
+#define COLLECTE_ANNEAU 0       // Le tableau des id fait le tour de l'anneau
+#define COLLECTE_GATHER 1       // MPI_Gather vers le leader
+#define COLLECTE_DOUBLEMENT 2   // Doublement récursif, chaque pair obtient tous les id
+#define COLLECTE_ALLGATHER 3    // MPI_Allgather, chaque pair obtient tous les id
+
+// Modes de distribution des finger tables par le leader
+#define DISTRIB_ANNEAU 0        // La totalité des tables fait le tour de l'anneau
+#define DISTRIB_SCATTER 1       // Chaque pair ne reçoit que sa table (MPI_Scatter)
+
+// Modes de calcul des finger tables
+#define FINGERS_LEADER 0        // Le leader calcule toutes les tables puis les distribue
+#define FINGERS_LOCAL 1         // Chaque pair calcule la sienne à partir de tous les id
+
+// Modes d'élection du leader
+#define ELECTION_HS 0           // Hirschberg et Sinclair sur l'anneau
+#define ELECTION_ALLREDUCE 1    // Un seul MPI_Allreduce du plus grand id d'initiateur
+#define ELECTION_COMPARER 2     // Les deux, durées affichées côte à côte
 
 // Structure qui contient les informations d'initialisation pour un pair
 typedef struct {
-    int id;
-    int pred_p;
-    int succ_p;
+    cle_t id;
+    cle_t pred_p;
+    cle_t succ_p;
     int init;
 } Infos;
 
 // Structure qui contient les informations pour l'éléction de leader
 typedef struct {
-    int init_sender;    // Id de l'initiateur du message
+    cle_t init_sender;  // Id de l'initiateur du message
     int direction;      // Indique dans quel sens le message circule dan l'anneau
     int k;              // Distance max du round
     int dist;           // Distance parcouru
 } Election;
 
+// Instantané d'un pair : sa place dans l'anneau, sa finger table et le leader
+// L'empreinte identifie l'anneau : elle mélange les id de tous les pairs, l'ensemble des initiateurs et
+// le leader, que la même élection désignerait donc à nouveau
+typedef struct {
+    EnteteInstantane entete;
+    uint64_t empreinte;
+    cle_t id;
+    cle_t pred;
+    cle_t succ;
+    cle_t leader;
+    cle_t finger_table[M];
+} InstantanePair;
+
+// Instantané du simulateur : les id des pairs, suivis de leurs indicateurs d'initiateur, repris tant que
+// leur nombre ne change pas
+typedef struct {
+    EnteteInstantane entete;
+    cle_t identifiers[];
+} InstantaneMembres;
 
-// Fonction de hachage simple
-int hash_function(int value, int max_value) {
-    return value % max_value;
+static inline size_t instantane_membres_taille(int num_pairs) {
+    return sizeof(InstantaneMembres) + num_pairs * (sizeof(cle_t) + sizeof(int));
 }
 
-// Vérifie qu'un id n'existe pas déjà dans la liste des identifiants 
-int identifier_exists(int id, int *identifiers, int size) {
-    for (int i = 0; i < size; i++) {
-        if (identifiers[i] == id) {
-            return 1;
-        }
+static inline int *instantane_initiateurs(const InstantaneMembres *membres, int num_pairs) {
+    return (int *)(membres->identifiers + num_pairs);
+}
+
+// Types MPI des messages : les Infos sont envoyées sans octet de remplissage, les messages d'élection
+// sont empaquetés au format external32, indépendant des processeurs ; l'annonce du leader ne porte que son id
+static MPI_Datatype INFOS_MPI;
+static MPI_Datatype ELECTION_MPI;
+
+void types_creer(void) {
+    int longueurs[] = { 1, 1, 1, 1 };
+    MPI_Datatype types[] = { CLE_MPI, CLE_MPI, CLE_MPI, MPI_INT };
+    MPI_Aint infos[] = { offsetof(Infos, id), offsetof(Infos, pred_p), offsetof(Infos, succ_p), offsetof(Infos, init) };
+    MPI_Datatype type;
+    MPI_Type_create_struct(4, longueurs, infos, types, &type);
+    MPI_Type_create_resized(type, 0, sizeof(Infos), &INFOS_MPI);
+    MPI_Type_free(&type);
+    MPI_Type_commit(&INFOS_MPI);
+
+    MPI_Datatype types_election[] = { CLE_MPI, MPI_INT, MPI_INT, MPI_INT };
+    MPI_Aint election[] = { offsetof(Election, init_sender), offsetof(Election, direction), offsetof(Election, k),
+                            offsetof(Election, dist) };
+    MPI_Type_create_struct(4, longueurs, election, types_election, &type);
+    MPI_Type_create_resized(type, 0, sizeof(Election), &ELECTION_MPI);
+    MPI_Type_free(&type);
+    MPI_Type_commit(&ELECTION_MPI);
+}
+
+void types_liberer(void) {
+    MPI_Type_free(&INFOS_MPI);
+    MPI_Type_free(&ELECTION_MPI);
+}
+
+
+// Récupération des id par doublement récursif (algorithme de Bruck) en ceil(log2 N) rondes
+// A la ronde k chaque pair envoie les 2^k id qu'il connait au pair situé 2^k rangs avant lui
+// A la fin identifiers[i] contient l'id du pair de rang i+1
+void collecter_ids_doublement(cle_t id_p, cle_t *identifiers, int num_pairs, MPI_Comm comm_pairs) {
+    int r;
+    MPI_Comm_rank(comm_pairs, &r);
+
+    // tampon[j] contiendra l'id du pair r+j
+    cle_t *tampon = (cle_t *)malloc(num_pairs * sizeof(cle_t));
+    tampon[0] = id_p;
+    for (int d = 1; d < num_pairs; d *= 2) {
+        int nb = d < num_pairs - d ? d : num_pairs - d;
+        int dest = (r - d + num_pairs) % num_pairs;
+        int source = (r + d) % num_pairs;
+        stats_sendrecv(tampon, nb, CLE_MPI, dest, TAG_GETID,
+                       tampon + d, nb, CLE_MPI, source, TAG_GETID, comm_pairs, MPI_STATUS_IGNORE);
     }
-    return 0;
+
+    for (int j = 0; j < num_pairs; j++) {
+        identifiers[(r + j) % num_pairs] = tampon[j];
+    }
+    free(tampon);
 }
 
-int elect_leader(int id_p, int pred_rank, int succ_rank, int init) {
-    int done = 0;
+// Etat d'un pair pendant l'élection
+typedef struct {
+    cle_t id_p;
+    int pred_rank;      // Rangs dans le communicateur de l'élection
+    int succ_rank;
+    int active;         // Indique si le noeud est encore candidat
+    int k;              // Distance du round en cours
+    int retours;        // Messages du round revenus au candidat
+    int tours;          // Messages du candidat revenus après un tour complet de l'anneau
+    cle_t leader_id;    // Identifiant du leader potentiel
+    int leader_connu;   // Indique si un candidat a déjà été vu
+    int termine;        // Le leader est connu, les messages restants sont absorbés
+    int en_vol;         // Envois pas encore reçus par leur destinataire
+    Moteur *moteur;
+} EtatElection;
+
+void election_envoyer(EtatElection *e, const Election *election, int dest, int tag) {
+    char *tampon = moteur_tampon(e->moteur);
+    MPI_Aint position = 0;
+    if (tag == TAG_LEADER) {
+        MPI_Pack_external("external32", &election->init_sender, 1, CLE_MPI, tampon, MOTEUR_TAILLE, &position);
+    } else {
+        MPI_Pack_external("external32", election, 1, ELECTION_MPI, tampon, MOTEUR_TAILLE, &position);
+    }
+    // Envoi synchrone : sa fin garantit que le message a été reçu, ce que la barrière finale exploite
+    moteur_envoyer_synchrone(e->moteur, tampon, (int)position, dest, tag, &e->en_vol);
+}
+
+// Envoie l'identifiant du candidat dans les deux directions pour le round en cours
+void election_round(EtatElection *e) {
+    Election election;
+    election.init_sender = e->id_p;
+    election.direction = 0;
+    election.k = e->k;
+    election.dist = 1;
+    e->retours = 0;
+    election_envoyer(e, &election, e->pred_rank, TAG_ELECTION);
+    election.direction = 1;
+    election_envoyer(e, &election, e->succ_rank, TAG_ELECTION);
+}
 
-    int active = init;  // Indique si le noeud est actif
-    int k = 1;  // Distance initiale
-    int leader_id = -1;  // Identifiant du leader potentiel
+// Traitement d'un message d'élection par le moteur du pair
+static void election_reception(void *ctx, int source, int tag, char *donnees, int octets) {
+    EtatElection *e = (EtatElection *)ctx;
+    char tmp[CLE_STR];
+    if (e->termine) return;
 
     Election election;
-    MPI_Status status;
-
-    // Boucle pour élire le leader
-    while (!done) {
-        if (active) {
-            // Comportement si le pair fait partie des candidat
-            leader_id = id_p;
-
-            election.init_sender = id_p;
-            election.direction = 0;
-            election.k = k;
-            election.dist = 1;
-            
-            // Envoyer l'identifiant dans les deux directions
-            MPI_Send(&election, sizeof(election), MPI_BYTE, pred_rank, TAG_ELECTION, MPI_COMM_WORLD);
-            election.direction = 1;
-            MPI_Send(&election, sizeof(election), MPI_BYTE, succ_rank, TAG_ELECTION, MPI_COMM_WORLD);
-
-            for (int i=0; i<2; i++) {
-                // Boucle sur la reception de message tant que le round n'est pas fini
-                MPI_Recv(&election, sizeof(election), MPI_BYTE, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-    
-                if (status.MPI_TAG == TAG_RET_ELECTION) {
-                   if (election.init_sender == id_p && election.dist < election.k) {
-                        // Passe inactif si le message n'a pas fini son chemin
-                        active = 0;
-    
-                    } else if (election.init_sender != id_p){
-                        // Poursuit le chemin retour du message
-                        int next_rank = election.direction ? succ_rank : pred_rank;
-                        MPI_Send(&election, sizeof(election), MPI_BYTE, next_rank, TAG_RET_ELECTION, MPI_COMM_WORLD);
-                    }
-    
-                } else if (status.MPI_TAG == TAG_ELECTION) {
-                    if (election.init_sender == id_p) {
-                        // Est élu leader si le message à fait le tour
-                        done = 1;
-                        break;
-                    } else if (election.init_sender > leader_id) {
-                        // Maj du leader si id plus grand
-                        leader_id = election.init_sender;
-                        active = 0;
-
-                        if (election.dist == election.k) {
-                            // Envoi le message retour
-                            int next_rank = election.direction ? pred_rank : succ_rank;
-                            election.direction = !election.direction;
-                            MPI_Send(&election, sizeof(election), MPI_BYTE, next_rank, TAG_RET_ELECTION, MPI_COMM_WORLD);
-                        } else {
-                            // Poursuit le chemin du message
-                            int next_rank = election.direction ? succ_rank : pred_rank;
-                            election.dist += 1;
-                            MPI_Send(&election, sizeof(election), MPI_BYTE, next_rank, TAG_ELECTION, MPI_COMM_WORLD);
-                        }
-                    }     
-                }
-            }
-            k *= 2;
+    MPI_Aint position = 0;
+    if (tag == TAG_LEADER) {
+        MPI_Unpack_external("external32", donnees, octets, &position, &election.init_sender, 1, CLE_MPI);
+    } else {
+        MPI_Unpack_external("external32", donnees, octets, &position, &election, 1, ELECTION_MPI);
+    }
 
+    if (tag == TAG_ELECTION) {
+        if (cle_egal(election.init_sender, e->id_p)) {
+            // Est élu leader quand les messages des deux directions ont fait le tour
+            if (++e->tours < 2) return;
+            printf("\n******************** ELECTION LEADER ********************\n");
+            printf("ID %s est élu leader.\n", cle_str(e->id_p, tmp));
+            e->leader_id = e->id_p;
+            // Fait circuler l'annonce du leader dans l'anneau
+            election_envoyer(e, &election, e->succ_rank, TAG_LEADER);
+            return;
+        }
+        if (e->active && cle_cmp(election.init_sender, e->id_p) < 0) {
+            // Un candidat absorbe les identifiants plus petits que le sien
+            return;
+        }
+        if (!e->leader_connu || cle_cmp(election.init_sender, e->leader_id) > 0) {
+            // Maj du leader si id plus grand
+            e->leader_id = election.init_sender;
+            e->leader_connu = 1;
+        }
+        e->active = 0;
+
+        if (election.dist == election.k) {
+            // Envoi le message retour
+            int next_rank = election.direction ? e->pred_rank : e->succ_rank;
+            election.direction = !election.direction;
+            election_envoyer(e, &election, next_rank, TAG_RET_ELECTION);
         } else {
-            // Boucle sur la reception de messages
-            MPI_Recv(&election, sizeof(election), MPI_BYTE, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-    
-            if (status.MPI_TAG == TAG_RET_ELECTION) {
-                // Poursuit le chemin retour du message
-                int next_rank = election.direction ? succ_rank : pred_rank;
-                MPI_Send(&election, sizeof(election), MPI_BYTE, next_rank, TAG_RET_ELECTION, MPI_COMM_WORLD);
-
-            } else if (status.MPI_TAG == TAG_ELECTION) {
-                if (election.init_sender > leader_id) { 
-                    // Maj du leader si id plus grand
-                    leader_id = election.init_sender;
-                }
+            // Poursuit le chemin du message
+            int next_rank = election.direction ? e->succ_rank : e->pred_rank;
+            election.dist += 1;
+            election_envoyer(e, &election, next_rank, TAG_ELECTION);
+        }
 
-                if (election.dist == election.k) {
-                    // Envoi le message retour
-                    int next_rank = election.direction ? pred_rank : succ_rank;
-                    election.direction = !election.direction;
-                    MPI_Send(&election, sizeof(election), MPI_BYTE, next_rank, TAG_RET_ELECTION, MPI_COMM_WORLD);
-                } else {
-                    // Poursuit le chemin du message
-                    int next_rank = election.direction ? succ_rank : pred_rank;
-                    election.dist += 1;
-                    MPI_Send(&election, sizeof(election), MPI_BYTE, next_rank, TAG_ELECTION, MPI_COMM_WORLD);
-                }
-            } else if (status.MPI_TAG == TAG_LEADER) {
-                // Récupère l'id du leader et fait suivre le message dans l'anneau
-                MPI_Send(&election, sizeof(election), MPI_BYTE, succ_rank, TAG_LEADER, MPI_COMM_WORLD);
-                return election.init_sender;
-            }
+    } else if (tag == TAG_RET_ELECTION) {
+        if (!cle_egal(election.init_sender, e->id_p)) {
+            // Poursuit le chemin retour du message
+            int next_rank = election.direction ? e->succ_rank : e->pred_rank;
+            election_envoyer(e, &election, next_rank, TAG_RET_ELECTION);
+        } else if (e->active && ++e->retours == 2) {
+            // Les deux messages sont revenus sans rencontrer plus grand : round suivant
+            e->k *= 2;
+            election_round(e);
+        }
+
+    } else if (tag == TAG_LEADER) {
+        if (!cle_egal(election.init_sender, e->id_p)) {
+            // Récupère l'id du leader et fait suivre le message dans l'anneau
+            e->leader_id = election.init_sender;
+            election_envoyer(e, &election, e->succ_rank, TAG_LEADER);
         }
+        e->termine = 1;
     }
+}
 
-    printf("\n******************** ELECTION LEADER ********************\n");
-    printf("ID %d est élu leader.\n", id_p);
-    election.init_sender = id_p;
-    election.direction = 1;
-    election.k = -1;
-    election.dist = -1;
-    
-    // Fait circuler l'annonce du leader dans l'anneau
-    MPI_Send(&election, sizeof(election), MPI_BYTE, succ_rank, TAG_LEADER, MPI_COMM_WORLD);
-    MPI_Recv(&election, sizeof(election), MPI_BYTE, pred_rank, TAG_LEADER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    return leader_id;
+// Election du leader par l'algorithme de Hirschberg et Sinclair, les rangs sont ceux de comm_pairs
+// Les messages sont traités par le moteur de progression, sur une copie du communicateur pour
+// ne pas se mêler aux phases suivantes
+cle_t elect_leader(cle_t id_p, int pred_rank, int succ_rank, int init, MPI_Comm comm_pairs) {
+    MPI_Comm comm;
+    MPI_Comm_dup(comm_pairs, &comm);
+    Moteur moteur;
+    EtatElection e;
+    memset(&e, 0, sizeof(EtatElection));
+    e.id_p = id_p;
+    e.pred_rank = pred_rank;
+    e.succ_rank = succ_rank;
+    e.active = init;
+    e.k = 1;
+    e.leader_id = id_p;
+    e.leader_connu = init;
+    e.moteur = &moteur;
+    moteur_init(&moteur, comm, election_reception, &e);
+
+    if (e.active) {
+        election_round(&e);
+    }
+    while (!e.termine) {
+        moteur_progresser(&moteur, 1);
+    }
+
+    // Les messages de candidats battus peuvent encore circuler : chaque pair les absorbe jusqu'à ce
+    // que tous ses envois aient été reçus, puis la barrière non bloquante garantit que c'est le cas
+    // pour tous les pairs
+    while (e.en_vol > 0) {
+        moteur_progresser(&moteur, 1);
+    }
+    int barriere = 0;
+    MPI_Request req;
+    MPI_Ibarrier(comm, &req);
+    moteur_suivre(&moteur, req, NULL, &barriere);
+    while (barriere > 0) {
+        moteur_progresser(&moteur, 1);
+    }
+
+    moteur_liberer(&moteur);
+    MPI_Comm_free(&comm);
+    return e.leader_id;
 }
 
-// Calcul des finger tables
-void calculate_finger_table(int id_p, int *identifiers, int num_pairs, int *finger_table) {
-    int max_id = 1 << M;  // 2^M, la taille maximale de l'espace d'identifiants
+// Candidature d'un pair pour l'élection par MPI_Allreduce
+typedef struct {
+    cle_t id;
+    int init;
+    int reserve;
+} Candidature;
+
+// Réduction équivalente à MPI_MAXLOC : garde le plus grand id parmi les initiateurs
+// cle_t pouvant dépasser 64 bits, les paires prédéfinies de MPI_MAXLOC ne conviennent pas
+static void candidature_max(void *entree, void *sortie, int *nb, MPI_Datatype *type) {
+    (void)type;
+    Candidature *a = (Candidature *)entree;
+    Candidature *b = (Candidature *)sortie;
+    for (int i = 0; i < *nb; i++) {
+        if (a[i].init && (!b[i].init || cle_cmp(a[i].id, b[i].id) > 0)) b[i] = a[i];
+    }
+}
 
-    // Parcours chaque entrée de la finger table
-    for (int i = 0; i < M; i++) {
-        // Calcule l'identifiant cible pour cette entrée de la finger table
-        int finger_id = (id_p + (int)pow(2, i)) % max_id;
+// Election du leader par une réduction : O(log N) étapes au lieu des O(N) rondes de Hirschberg et
+// Sinclair, avec le même résultat puisque l'initiateur de plus grand id l'emporte
+cle_t elect_leader_allreduce(cle_t id_p, int init, MPI_Comm comm_pairs) {
+    MPI_Datatype type;
+    MPI_Op op;
+    MPI_Type_contiguous(sizeof(Candidature), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+    MPI_Op_create(candidature_max, 1, &op);
+
+    Candidature moi, leader;
+    memset(&moi, 0, sizeof(Candidature));
+    moi.id = id_p;
+    moi.init = init;
+    stats_collective(1, type);
+    MPI_Allreduce(&moi, &leader, 1, type, op, comm_pairs);
+
+    MPI_Op_free(&op);
+    MPI_Type_free(&type);
+    return leader.id;
+}
 
-        int successor = max_id;
-        int minId = max_id;
+/********** INSTANTANES **********/
 
-        // Trouve le successeur de finger_id
-        for (int j = 0; j < num_pairs; j++) {
-            // Si l'identifiant du pair est supérieur ou égal à finger_id et inférieur au successeur actuel
-            // On le met à jour
-            if (identifiers[j] >= finger_id && identifiers[j] < successor) {
-                successor = identifiers[j];
-            }
+// Somme des hachés des id de tous les pairs, indépendante de leur ordre
+// Le haché dépend aussi de l'indicateur d'initiateur, la somme change donc avec l'ensemble des initiateurs
+uint64_t somme_ids(cle_t id_p, int init, MPI_Comm comm_pairs) {
+    uint64_t h = hash64(&id_p, sizeof(cle_t), init != 0), somme;
+    stats_collective(1, MPI_UINT64_T);
+    MPI_Allreduce(&h, &somme, 1, MPI_UINT64_T, MPI_SUM, comm_pairs);
+    return somme;
+}
 
-            // Maj du plus petit successeur
-            if (identifiers[j] < minId) {
-                minId = identifiers[j];
-            }
-        }
-        
-        // Si aucun successeur alors on a fait le tour de l'anneau donc le successeur de finger_id
-        // est le plus petit successeur
-        if (successor == max_id) {
-            successor = minId;
-        }
+static inline uint64_t empreinte_anneau(uint64_t somme, cle_t leader) {
+    return hash_mix(somme ^ INSTANTANE_MAGIC, hash64(&leader, sizeof(cle_t), 1));
+}
 
-        // Stock le successeur dans la finger_table
-        finger_table[i] = successor;
+// Projette l'instantané du pair et le garde s'il est valide et décrit l'anneau courant : même id,
+// prédécesseur et successeur pour le pair, empreinte calculée sur les id actuels pour tous
+// Tous les pairs doivent garder le leur, sinon aucun ne le garde et NULL est retourné
+const InstantanePair *instantane_reprendre(const char *chemin, const Infos *infos, int num_pairs, uint64_t somme,
+                                           MPI_Comm comm_pairs, size_t *taille) {
+    const InstantanePair *s = (const InstantanePair *)instantane_ouvrir(chemin, sizeof(InstantanePair), num_pairs, taille);
+    int valide = s != NULL && cle_egal(s->id, infos->id) && cle_egal(s->pred, infos->pred_p)
+                 && cle_egal(s->succ, infos->succ_p) && s->empreinte == empreinte_anneau(somme, s->leader);
+    int tous;
+    stats_collective(1, MPI_INT);
+    MPI_Allreduce(&valide, &tous, 1, MPI_INT, MPI_MIN, comm_pairs);
+    if (!tous) {
+        instantane_fermer(s, *taille);
+        return NULL;
     }
+    return s;
 }
 
 int main(int argc, char **argv) {
     MPI_Init(&argc, &argv);
+    cle_init_mpi();
+    types_creer();
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     int num_pairs = size - 1;
+    trace_init(rank);
+
+    // Options : -g anneau|gather|doublement|allgather pour la récupération des id
+    //           -d anneau|scatter pour la distribution des finger tables
+    //           -e hs|allreduce|comparer pour l'élection du leader
+    //           -f leader|local pour le calcul des finger tables
+    //           -r fichier pour écrire le rapport d'instrumentation en CSV ("-" pour la sortie standard)
+    //           -s répertoire des instantanés de l'anneau, repris au lancement suivant
+    int collecte = COLLECTE_ANNEAU;
+    int distribution = DISTRIB_ANNEAU;
+    int election = ELECTION_HS;
+    int calcul = FINGERS_LEADER;
+    int collecte_choisie = 0;
+    const char *rapport = NULL;
+    const char *repertoire = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:d:e:f:r:s:")) != -1) {
+        if (opt == 'r') {
+            rapport = optarg;
+            continue;
+        }
+        if (opt == 's') {
+            repertoire = optarg;
+            continue;
+        }
+        if (opt == 'g') collecte_choisie = 1;
+        if (opt == 'g' && strcmp(optarg, "anneau") == 0) {
+            collecte = COLLECTE_ANNEAU;
+        } else if (opt == 'g' && strcmp(optarg, "gather") == 0) {
+            collecte = COLLECTE_GATHER;
+        } else if (opt == 'g' && strcmp(optarg, "doublement") == 0) {
+            collecte = COLLECTE_DOUBLEMENT;
+        } else if (opt == 'g' && strcmp(optarg, "allgather") == 0) {
+            collecte = COLLECTE_ALLGATHER;
+        } else if (opt == 'd' && strcmp(optarg, "anneau") == 0) {
+            distribution = DISTRIB_ANNEAU;
+        } else if (opt == 'd' && strcmp(optarg, "scatter") == 0) {
+            distribution = DISTRIB_SCATTER;
+        } else if (opt == 'e' && strcmp(optarg, "hs") == 0) {
+            election = ELECTION_HS;
+        } else if (opt == 'e' && strcmp(optarg, "allreduce") == 0) {
+            election = ELECTION_ALLREDUCE;
+        } else if (opt == 'e' && strcmp(optarg, "comparer") == 0) {
+            election = ELECTION_COMPARER;
+        } else if (opt == 'f' && strcmp(optarg, "leader") == 0) {
+            calcul = FINGERS_LEADER;
+        } else if (opt == 'f' && strcmp(optarg, "local") == 0) {
+            calcul = FINGERS_LOCAL;
+        } else {
+            if (rank == 0) fprintf(stderr, "Usage: %s [-g anneau|gather|doublement|allgather] [-d anneau|scatter] [-e hs|allreduce|comparer] [-f leader|local] [-r rapport.csv] [-s repertoire]\n", argv[0]);
+            MPI_Finalize();
+            return 1;
+        }
+    }
 
-    int id_p;
-    int succ_p;
-    int pred_p;
-    int init;
-    int *identifiers = NULL;
-    int *finger_table = NULL;
-    int *finger_tables = NULL;
+    // Sans leader pour les calculer, chaque pair doit connaître tous les id : seules les collectes qui les
+    // donnent à tous sont acceptées, allgather par défaut
+    if (calcul == FINGERS_LOCAL && collecte != COLLECTE_DOUBLEMENT && collecte != COLLECTE_ALLGATHER) {
+        if (collecte_choisie) {
+            if (rank == 0) fprintf(stderr, "Erreur: -f local demande -g doublement ou -g allgather\n");
+            MPI_Finalize();
+            return 1;
+        }
+        collecte = COLLECTE_ALLGATHER;
+    }
+
+    stats_nommer_tag(TAG_INIT, "TAG_INIT");
+    stats_nommer_tag(TAG_ELECTION, "TAG_ELECTION");
+    stats_nommer_tag(TAG_RET_ELECTION, "TAG_RET_ELECTION");
+    stats_nommer_tag(TAG_LEADER, "TAG_LEADER");
+    stats_nommer_tag(TAG_GETID, "TAG_GETID");
+    stats_nommer_tag(TAG_FINGERS, "TAG_FINGERS");
+    stats_nommer_phase(PHASE_INIT, "initialisation");
+    stats_nommer_phase(PHASE_ELECTION, "election");
+    stats_nommer_phase(PHASE_COLLECTE, "collecte_id");
+    stats_nommer_phase(PHASE_CALCUL, "calcul_fingers");
+    stats_nommer_phase(PHASE_DISTRIBUTION, "distribution_fingers");
+    if (repertoire != NULL) stats_nommer_phase(PHASE_INSTANTANE, "instantanes");
+
+    // Communicateur regroupant uniquement les pairs, sans le simulateur
+    MPI_Comm comm_pairs;
+    MPI_Comm_split(MPI_COMM_WORLD, rank == 0 ? MPI_UNDEFINED : 0, rank, &comm_pairs);
+
+    // L'espace d'identifiants doit pouvoir accueillir tous les pairs
+#if M < 31
+    if (num_pairs > (1 << M)) {
+        if (rank == 0) fprintf(stderr, "Erreur: %d pairs pour un espace de 2^%d identifiants\n", num_pairs, M);
+        MPI_Finalize();
+        return 1;
+    }
+#endif
+
+    cle_t id_p;
+    cle_t succ_p;
+    cle_t pred_p;
+    int init = 0;
+    cle_t *identifiers = NULL;
+    cle_t *finger_table = NULL;
+    cle_t *finger_tables = NULL;
     Infos infos;
+    char tmp[CLE_STR], tmp2[CLE_STR], tmp3[CLE_STR];
 
     /********** INITIALISATION SIMULATEUR **********/
+    stats_phase_debut(PHASE_INIT);
     if (rank == 0) {
         printf("******************** INITIALISATION ********************\n");
 
-        // Initialisation des identifiants des pairs
-        identifiers = (int *)malloc(num_pairs * sizeof(int));
+        // Initialisation des identifiants des pairs et des initiateurs, repris du dernier instantané avec -s
+        identifiers = (cle_t *)malloc(num_pairs * sizeof(cle_t));
+        int *initiators = (int *)calloc(num_pairs, sizeof(int));
         srand(time(NULL));
-        for (int i = 0; i < num_pairs; i++) {
-            int id;
-            do {
-                id = hash_function(rand(), 1 << M);
-            } while (identifier_exists(id, identifiers, i));
-            identifiers[i] = id;
+        const InstantaneMembres *membres = NULL;
+        size_t taille_membres = instantane_membres_taille(num_pairs);
+        char chemin[4096];
+        if (repertoire != NULL) {
+            snprintf(chemin, sizeof(chemin), "%s/membres.bin", repertoire);
+            membres = (const InstantaneMembres *)instantane_ouvrir(chemin, taille_membres, num_pairs, &taille_membres);
+        }
+        int repris = membres != NULL;
+        if (repris) {
+            memcpy(identifiers, membres->identifiers, num_pairs * sizeof(cle_t));
+            memcpy(initiators, instantane_initiateurs(membres, num_pairs), num_pairs * sizeof(int));
+            instantane_fermer(membres, taille_membres);
+            printf("Simulateur: membres et initiateurs repris de %s\n", chemin);
+        } else {
+            cle_t *ids_tries = (cle_t *)malloc(num_pairs * sizeof(cle_t));
+            int *rangs_tries = (int *)malloc(num_pairs * sizeof(int));
+            generer_identifiants(identifiers, num_pairs, ids_tries, rangs_tries);
+            free(ids_tries);
+            free(rangs_tries);
         }
 
         // Affichage des identifiants
         printf("Simulateur: Identifiants des pairs = [ ");
         for (int i = 0; i < num_pairs; i++) {
-            printf("%d ", identifiers[i]);
+            printf("%s ", cle_str(identifiers[i], tmp));
         }
         printf("]\n");
 
-        // Determine le nombre de pairs initiateurs
-        int nb_initiators = (rand() % num_pairs) + 1;
-        printf("Simulateur : L'ensemble des initiateurs est compose de %d pair(s) : \n", nb_initiators);
-
-        // Sélectionner aléatoirement les pairs initiateurs
-        int *initiators = (int *)malloc(num_pairs * sizeof(int));
-        for (int i = 0; i < num_pairs; i++) {
-            initiators[i] = 0;
-        }
-        for (int i = 0; i < nb_initiators; i++) {
-            int init_index;
-            do {
-                init_index = rand() % num_pairs;
-            } while (initiators[init_index] == 1);
-            initiators[init_index] = 1;
-            printf("\t=> Pair %d est un initiateur.\n", identifiers[init_index]);
+        if (!repris) {
+            // Determine le nombre de pairs initiateurs
+            int nb_initiators = (rand() % num_pairs) + 1;
+            printf("Simulateur : L'ensemble des initiateurs est compose de %d pair(s) : \n", nb_initiators);
+
+            // Sélectionner aléatoirement les pairs initiateurs
+            for (int i = 0; i < nb_initiators; i++) {
+                int init_index;
+                do {
+                    init_index = rand() % num_pairs;
+                } while (initiators[init_index] == 1);
+                initiators[init_index] = 1;
+                printf("\t=> Pair %s est un initiateur.\n", cle_str(identifiers[init_index], tmp));
+            }
+            printf("\n");
+
+            // Les initiateurs sont gardés avec les membres : l'élection, et donc le leader des instantanés
+            // des pairs, ne change pas au lancement suivant
+            if (repertoire != NULL) {
+                InstantaneMembres *nouveau = (InstantaneMembres *)calloc(1, taille_membres);
+                memcpy(nouveau->identifiers, identifiers, num_pairs * sizeof(cle_t));
+                memcpy(instantane_initiateurs(nouveau, num_pairs), initiators, num_pairs * sizeof(int));
+                instantane_ecrire(chemin, nouveau, taille_membres, num_pairs);
+                free(nouveau);
+            }
+        } else {
+            printf("Simulateur : initiateurs repris : ");
+            for (int i = 0; i < num_pairs; i++) {
+                if (initiators[i]) printf("%s ", cle_str(identifiers[i], tmp));
+            }
+            printf("\n\n");
         }
-        printf("\n");
 
         // Envoi les infos aux pairs et les organise en anneau
         for (int i=0; i<num_pairs; i++) {
@@ -259,7 +560,7 @@ int main(int argc, char **argv) {
             infos.init = initiators[i];
 
             // Envoi de la structure
-            MPI_Send(&infos, sizeof(Infos), MPI_BYTE, i+1, 0, MPI_COMM_WORLD);     
+            stats_send(&infos, 1, INFOS_MPI, i+1, TAG_INIT, MPI_COMM_WORLD);
         }
 
 
@@ -268,92 +569,252 @@ int main(int argc, char **argv) {
 
     } else {
         // Reception de la structure
-        MPI_Recv(&infos, sizeof(Infos), MPI_BYTE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        stats_recv(&infos, 1, INFOS_MPI, 0, TAG_INIT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         id_p = infos.id;
         pred_p = infos.pred_p;
         succ_p = infos.succ_p;
         init = infos.init;
-        printf("ID : %d, Pred : %d, Succ : %d, Init : %d\n", id_p, pred_p, succ_p, init);    
+        TRACE(TRACE_INFO, "ID : %s, Pred : %s, Succ : %s, Init : %d\n", cle_str(id_p, tmp), cle_str(pred_p, tmp2), cle_str(succ_p, tmp3), init);
     }
+    stats_phase_fin(PHASE_INIT);
     /******** FIN INITIALISATION SIMULATEUR ********/
 
     if (rank != 0) {
-        /********** ELECTION LEADER **********/
+        /********** REPRISE DES INSTANTANES **********/
+
+        // Avec -s, le pair reprend son instantané si tous les pairs ont le leur pour l'anneau courant,
+        // et l'initialisation complète n'est faite que si les membres ont changé
+        cle_t leader;
+        int est_leader;
+        const InstantanePair *instantane = NULL;
+        size_t taille_instantane = 0;
+        uint64_t somme = 0;
+        char chemin[4096];
+        if (repertoire != NULL) {
+            snprintf(chemin, sizeof(chemin), "%s/anneau_%d.bin", repertoire, rank);
+            MPI_Barrier(comm_pairs);
+            stats_phase_debut(PHASE_INSTANTANE);
+            somme = somme_ids(id_p, init, comm_pairs);
+            instantane = instantane_reprendre(chemin, &infos, num_pairs, somme, comm_pairs, &taille_instantane);
+            MPI_Barrier(comm_pairs);
+            double duree = stats_phase_fin(PHASE_INSTANTANE);
+            if (instantane != NULL) {
+                leader = instantane->leader;
+                est_leader = cle_egal(id_p, leader);
+                finger_table = (cle_t *)instantane->finger_table;
+                if (est_leader) printf("Leader: anneau repris des instantanés de %s en %.6f s\n", repertoire, duree);
+            }
+        }
 
-        int pred_rank = rank-1 == 0 ? size-1 : rank-1;
-        int succ_rank = rank+1 == size ? 1 : rank+1;
+        if (instantane == NULL) {
+            /********** ELECTION LEADER **********/
+
+            int pred_rank = rank-1 == 0 ? size-1 : rank-1;
+            int succ_rank = rank+1 == size ? 1 : rank+1;
+
+            // Lance l'élection du leader, chaque mode étant mesuré entre deux barrières
+            double durees[2] = { 0, 0 };
+            MPI_Barrier(comm_pairs);
+            stats_phase_debut(PHASE_ELECTION);
+            if (election != ELECTION_ALLREDUCE) {
+                double debut = MPI_Wtime();
+                leader = elect_leader(id_p, pred_rank - 1, succ_rank - 1, init, comm_pairs);
+                MPI_Barrier(comm_pairs);
+                durees[ELECTION_HS] = MPI_Wtime() - debut;
+            }
+            if (election != ELECTION_HS) {
+                double debut = MPI_Wtime();
+                cle_t leader_allreduce = elect_leader_allreduce(id_p, init, comm_pairs);
+                MPI_Barrier(comm_pairs);
+                durees[ELECTION_ALLREDUCE] = MPI_Wtime() - debut;
+                if (election == ELECTION_COMPARER && !cle_egal(leader, leader_allreduce)) {
+                    printf("Erreur: ID %s élu par Hirschberg et Sinclair, %s par MPI_Allreduce\n",
+                           cle_str(leader, tmp), cle_str(leader_allreduce, tmp2));
+                }
+                if (election == ELECTION_ALLREDUCE && cle_egal(id_p, leader_allreduce)) {
+                    printf("\n******************** ELECTION LEADER ********************\n");
+                    printf("ID %s est élu leader.\n", cle_str(id_p, tmp));
+                }
+                leader = leader_allreduce;
+            }
+            stats_phase_fin(PHASE_ELECTION);
+            if (cle_egal(id_p, leader)) {
+                if (election != ELECTION_ALLREDUCE) printf("Leader: élection (hs) en %.6f s\n", durees[ELECTION_HS]);
+                if (election != ELECTION_HS) printf("Leader: élection (allreduce) en %.6f s\n", durees[ELECTION_ALLREDUCE]);
+            }
 
-        // Lance l'élection du leader
-        int leader = elect_leader(id_p, pred_rank, succ_rank, init);
 
+            /********** RECUPERATION DES ID **********/
 
-        /********** RECUPERATION DES ID **********/
+            identifiers = (cle_t *)calloc(num_pairs, sizeof(cle_t));
+            if (identifiers == NULL) {
+                printf("Erreur malloc\n");
+                return -1;
+            }
 
-        identifiers = (int *)malloc(num_pairs * sizeof(int));
-        if (identifiers == NULL) {
-            printf("Erreur malloc\n");
-            return -1;
-        }
-        for (int i=0; i<num_pairs; i++) {
-            identifiers[i] = -1;
-        }
+            est_leader = cle_egal(id_p, leader);
 
-        if (leader == id_p) {
-            identifiers[rank-1] = id_p;
-            MPI_Send(identifiers, num_pairs, MPI_INT, succ_rank, TAG_GETID, MPI_COMM_WORLD);
-            MPI_Recv(identifiers, num_pairs, MPI_INT, pred_rank, TAG_GETID, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            // Affichage des identifiants
-            printf("Leader: Identifiants des pairs = [ ");
-            for (int i = 0; i < num_pairs; i++) {
-                printf("%d ", identifiers[i]);
+            // Le rang du leader parmi les pairs est nécessaire comme racine des collectives
+            int leader_rank = -1;
+            if (collecte == COLLECTE_GATHER || distribution == DISTRIB_SCATTER) {
+                int mon_rang = est_leader ? rank-1 : -1;
+                MPI_Allreduce(&mon_rang, &leader_rank, 1, MPI_INT, MPI_MAX, comm_pairs);
+                stats_collective(1, MPI_INT);
             }
-            printf("]\n\n");
 
-            printf("********************* FINGER TABLES *********************\n");
-        } else {
-            MPI_Recv(identifiers, num_pairs, MPI_INT, pred_rank, TAG_GETID, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            identifiers[rank-1] = id_p;
-            MPI_Send(identifiers, num_pairs, MPI_INT, succ_rank, TAG_GETID, MPI_COMM_WORLD);
-        }
-       
+            MPI_Barrier(comm_pairs);
+            stats_phase_debut(PHASE_COLLECTE);
+
+            if (collecte == COLLECTE_GATHER) {
+                stats_collective(1, CLE_MPI);
+                MPI_Gather(&id_p, 1, CLE_MPI, identifiers, 1, CLE_MPI, leader_rank, comm_pairs);
+            } else if (collecte == COLLECTE_DOUBLEMENT) {
+                collecter_ids_doublement(id_p, identifiers, num_pairs, comm_pairs);
+            } else if (collecte == COLLECTE_ALLGATHER) {
+                stats_collective(1, CLE_MPI);
+                MPI_Allgather(&id_p, 1, CLE_MPI, identifiers, 1, CLE_MPI, comm_pairs);
+            } else if (est_leader) {
+                identifiers[rank-1] = id_p;
+                stats_send(identifiers, num_pairs, CLE_MPI, succ_rank, TAG_GETID, MPI_COMM_WORLD);
+                stats_recv(identifiers, num_pairs, CLE_MPI, pred_rank, TAG_GETID, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            } else {
+                stats_recv(identifiers, num_pairs, CLE_MPI, pred_rank, TAG_GETID, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                identifiers[rank-1] = id_p;
+                stats_send(identifiers, num_pairs, CLE_MPI, succ_rank, TAG_GETID, MPI_COMM_WORLD);
+            }
 
-        /********** CALCUL FINGER TABLE **********/
+            MPI_Barrier(comm_pairs);
+            double duree = stats_phase_fin(PHASE_COLLECTE);
+            if (est_leader) {
+                const char *noms_collecte[] = { "anneau", "gather", "doublement", "allgather" };
+                printf("Leader: récupération des id (%s) en %.6f s\n", noms_collecte[collecte], duree);
 
-        // VA contenir les finger tables
-        finger_tables = (int *)malloc(M * sizeof(int)* num_pairs);
-        if (finger_tables == NULL) {
-            printf("Erreur malloc\n");
-            return -1;
-        }
+                // Affichage des identifiants
+                printf("Leader: Identifiants des pairs = [ ");
+                for (int i = 0; i < num_pairs; i++) {
+                    printf("%s ", cle_str(identifiers[i], tmp));
+                }
+                printf("]\n\n");
 
-        if (id_p == leader) {
-            for (int i=0; i<num_pairs; i++) {
-                // Calcul de la finger table
-                calculate_finger_table(identifiers[i], identifiers, num_pairs, finger_tables+(i*M)); 
+                printf("********************* FINGER TABLES *********************\n");
+            }
+
+
+            /********** CALCUL FINGER TABLE **********/
+
+            // VA contenir les finger tables, en mode scatter seul le leader les stocke toutes
+            // et en mode local aucun pair ne les stocke
+            finger_table = (cle_t *)malloc(M * sizeof(cle_t));
+            if (calcul == FINGERS_LEADER && (est_leader || distribution == DISTRIB_ANNEAU)) {
+                finger_tables = (cle_t *)malloc(M * sizeof(cle_t)* num_pairs);
+                if (finger_tables == NULL) {
+                    printf("Erreur malloc\n");
+                    return -1;
+                }
+            }
+
+            MPI_Barrier(comm_pairs);
+            stats_phase_debut(PHASE_CALCUL);
+            if (calcul == FINGERS_LOCAL) {
+                // Chaque pair trie les identifiants puis cherche chacun de ses fingers par dichotomie
+                cle_t *ids_tries = (cle_t *)malloc(num_pairs * sizeof(cle_t));
+                int *rangs_tries = (int *)malloc(num_pairs * sizeof(int));
+                trier_identifiants(identifiers, num_pairs, ids_tries, rangs_tries);
+                calculate_finger_table(id_p, ids_tries, NULL, num_pairs, finger_table, NULL);
+                free(ids_tries);
+                free(rangs_tries);
+            } else if (est_leader) {
+                // Tri des identifiants puis calcul de toutes les finger tables en un balayage
+                cle_t *ids_tries = (cle_t *)malloc(num_pairs * sizeof(cle_t));
+                int *rangs_tries = (int *)malloc(num_pairs * sizeof(int));
+                trier_identifiants(identifiers, num_pairs, ids_tries, rangs_tries);
+                calculer_finger_tables(ids_tries, rangs_tries, num_pairs, finger_tables, NULL);
+                free(ids_tries);
+                free(rangs_tries);
+            }
+            MPI_Barrier(comm_pairs);
+            duree = stats_phase_fin(PHASE_CALCUL);
+            if (est_leader) {
+                printf("Leader: calcul des finger tables (%s) en %.6f s\n", calcul == FINGERS_LOCAL ? "local" : "leader", duree);
+            }
+
+
+            /********** DISTRIBUTION FINGER TABLE **********/
+
+            MPI_Barrier(comm_pairs);
+            stats_phase_debut(PHASE_DISTRIBUTION);
+
+            if (calcul == FINGERS_LOCAL) {
+                // Chaque pair a déjà sa table
+            } else if (distribution == DISTRIB_SCATTER) {
+                // Chaque pair ne reçoit que ses M entrées
+                stats_collective(est_leader ? num_pairs*M : M, CLE_MPI);
+                MPI_Scatter(finger_tables, M, CLE_MPI, finger_table, M, CLE_MPI, leader_rank, comm_pairs);
+            } else if (est_leader) {
+                // Fait circuler les fingers tables dans l'anneau
+                stats_send(finger_tables, num_pairs*M, CLE_MPI, pred_rank, TAG_FINGERS, MPI_COMM_WORLD);
+                stats_recv(finger_tables, num_pairs*M, CLE_MPI, succ_rank, TAG_FINGERS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                memcpy(finger_table, finger_tables+(rank-1)*M, M * sizeof(cle_t));
+            } else {
+                // Reception finger table
+                stats_recv(finger_tables, num_pairs*M, CLE_MPI, succ_rank, TAG_FINGERS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                // Récupère uniquement sa finger table et fait suivre le message au successeur
+                memcpy(finger_table, finger_tables+(rank-1)*M, M * sizeof(cle_t));
+                stats_send(finger_tables, num_pairs*M, CLE_MPI, pred_rank, TAG_FINGERS, MPI_COMM_WORLD);
+            }
+
+            MPI_Barrier(comm_pairs);
+            duree = stats_phase_fin(PHASE_DISTRIBUTION);
+            if (est_leader && calcul == FINGERS_LEADER) {
+                printf("Leader: distribution des finger tables (%s) en %.6f s\n",
+                       distribution == DISTRIB_SCATTER ? "scatter" : "anneau", duree);
+            }
+
+            if (repertoire != NULL) {
+                // Nouvel instantané du pair, l'empreinte de l'anneau est la même pour tous
+                InstantanePair nouveau;
+                memset(&nouveau, 0, sizeof(InstantanePair));
+                nouveau.empreinte = empreinte_anneau(somme, leader);
+                nouveau.id = id_p;
+                nouveau.pred = infos.pred_p;
+                nouveau.succ = infos.succ_p;
+                nouveau.leader = leader;
+                memcpy(nouveau.finger_table, finger_table, M * sizeof(cle_t));
+                stats_phase_debut(PHASE_INSTANTANE);
+                int ecrit = instantane_ecrire(chemin, &nouveau, sizeof(InstantanePair), num_pairs) == 0, tous;
+                MPI_Allreduce(&ecrit, &tous, 1, MPI_INT, MPI_MIN, comm_pairs);
+                stats_collective(1, MPI_INT);
+                stats_phase_fin(PHASE_INSTANTANE);
+                if (est_leader) {
+                    printf("Leader: instantanés absents ou d'un autre anneau, initialisation complète%s\n",
+                           tous ? ", nouveaux instantanés écrits" : " (écriture des instantanés impossible)");
+                }
             }
-            // Fait circuler les fingers tables dans l'anneau
-            MPI_Send(finger_tables, num_pairs*M, MPI_INT, pred_rank, 0, MPI_COMM_WORLD);
-            MPI_Recv(finger_tables, num_pairs*M, MPI_INT, succ_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            finger_table = finger_tables+(rank-1)*M;
-        } else {
-            // Reception finger table
-            MPI_Recv(finger_tables, num_pairs*M, MPI_INT, succ_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            // Récupère uniquement sa finger table et fait suivre le message au successeur
-            finger_table = finger_tables+(rank-1)*M;
-            MPI_Send(finger_tables, num_pairs*M, MPI_INT, pred_rank, 0, MPI_COMM_WORLD);
         }
 
         // Affichage des résultats
-        printf("ID: %d: Finger Table = [ ", id_p);
         for (int i = 0; i < M; i++) {
-            printf("%d ", finger_table[i]);
+            TRACE(TRACE_DEBUG, "ID: %s: Finger %d = %s\n", cle_str(id_p, tmp), i, cle_str(finger_table[i], tmp2));
         }
-        printf("], Successeur = %d\n", finger_table[0]);
+        TRACE(TRACE_INFO, "ID: %s: Successeur = %s\n", cle_str(id_p, tmp), cle_str(finger_table[0], tmp2));
 
         free(identifiers);
         free(finger_tables);
+        if (instantane != NULL) {
+            instantane_fermer(instantane, taille_instantane);
+        } else {
+            free(finger_table);
+        }
+        MPI_Comm_free(&comm_pairs);
+    }
+
+    if (rapport != NULL) {
+        stats_rapport(rapport, MPI_COMM_WORLD);
     }
 
+    trace_vider();
+    types_liberer();
+    cle_liberer_mpi();
     MPI_Finalize();
     return 0;
 }
@@ -0,0 +1,97 @@
+#ifndef INSTANTANE_H
+#define INSTANTANE_H
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chord.h"
+
+// Instantanés binaires de l'anneau, pour redémarrer sans refaire l'initialisation
+// Un fichier commence par un entête versionné suivi de son contenu ; la somme de contrôle couvre tout ce
+// qui la suit. Un instantané est écrit dans un fichier temporaire puis renommé, un fichier lu est donc
+// toujours complet. Il est relu par mmap et utilisé en place, sans copie
+// Un instantané écrit avec une autre largeur d'identifiants ou un autre nombre de pairs est refusé
+
+#define INSTANTANE_MAGIC UINT64_C(0x314e4144524f4843)  // "CHORDAN1" en mémoire
+#define INSTANTANE_VERSION 2
+
+typedef struct {
+    uint64_t magic;
+    uint64_t somme;         // hash64 de tout ce qui suit
+    uint32_t version;
+    uint32_t m;
+    uint32_t taille_cle;
+    int32_t nb_pairs;
+} EnteteInstantane;
+
+static inline uint64_t instantane_somme(const void *instantane, size_t taille) {
+    size_t debut = offsetof(EnteteInstantane, version);
+    return hash64((const char *)instantane + debut, taille - debut, INSTANTANE_MAGIC);
+}
+
+// Ecrit l'instantané de taille octets, qui commence par son entête, dont les champs sont remplis ici
+// Retourne 0 en cas de succès, -1 sinon
+static inline int instantane_ecrire(const char *chemin, void *instantane, size_t taille, int nb_pairs) {
+    EnteteInstantane *e = (EnteteInstantane *)instantane;
+    e->magic = INSTANTANE_MAGIC;
+    e->version = INSTANTANE_VERSION;
+    e->m = M;
+    e->taille_cle = sizeof(cle_t);
+    e->nb_pairs = nb_pairs;
+    e->somme = instantane_somme(instantane, taille);
+
+    char temporaire[4096];
+    snprintf(temporaire, sizeof(temporaire), "%s.tmp", chemin);
+    FILE *f = fopen(temporaire, "wb");
+    if (f == NULL) {
+        perror(temporaire);
+        return -1;
+    }
+    int ok = fwrite(instantane, taille, 1, f) == 1;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temporaire, chemin) != 0) {
+        perror(chemin);
+        unlink(temporaire);
+        return -1;
+    }
+    return 0;
+}
+
+// Projette l'instantané en mémoire et le vérifie : entête, taille et somme de contrôle
+// Avec taille_attendue à 0 la taille est libre et renvoyée dans *taille
+// Retourne l'instantané en lecture seule, ou NULL s'il est absent ou invalide
+static inline const void *instantane_ouvrir(const char *chemin, size_t taille_attendue, int nb_pairs, size_t *taille) {
+    int fd = open(chemin, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(EnteteInstantane)
+            || (taille_attendue != 0 && (size_t)st.st_size != taille_attendue)) {
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+
+    const EnteteInstantane *e = (const EnteteInstantane *)p;
+    if (e->magic != INSTANTANE_MAGIC || e->version != INSTANTANE_VERSION || e->m != M
+            || e->taille_cle != sizeof(cle_t) || e->nb_pairs != nb_pairs
+            || e->somme != instantane_somme(p, st.st_size)) {
+        munmap(p, st.st_size);
+        return NULL;
+    }
+    *taille = st.st_size;
+    return p;
+}
+
+static inline void instantane_fermer(const void *instantane, size_t taille) {
+    if (instantane != NULL) munmap((void *)instantane, taille);
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef MOTEUR_H
+#define MOTEUR_H
+
+#include <mpi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+// Moteur de progression des échanges d'un processus
+// Des réceptions MPI_Irecv sont postées à l'avance sur des tampons de taille fixe et reposées dès que
+// le message a été traité ; les envois partent en MPI_Isend. Toutes les requêtes en cours sont
+// complétées par un seul MPI_Waitsome : un pair traite les messages de tous les protocoles à mesure
+// qu'ils arrivent et ne se bloque jamais sur un envoi
+// Un moteur sans fonction de traitement ne poste aucune réception : il sert aux envois d'un thread
+// ouvrier, les messages étant reçus par le moteur du thread de communication
+
+#define MOTEUR_TAILLE (64 * 1024)   // Taille max d'un message
+#define MOTEUR_RECEPTIONS 8         // Nombre de réceptions postées à l'avance
+
+// Traitement d'un message reçu, le tampon est reposté en réception après le retour
+typedef void (*MoteurTraitement)(void *ctx, int source, int tag, char *donnees, int octets);
+
+typedef struct {
+    MPI_Comm comm;
+    // Requêtes suivies : les nb_receptions premières sont les réceptions, viennent ensuite
+    // les envois et autres requêtes non bloquantes, chacune avec son tampon et son compteur
+    int nb_receptions;
+    MPI_Request *requetes;
+    char **tampons;
+    int **compteurs;
+    unsigned long *sequences;   // Ordre de dépôt des réceptions
+    int nb_requetes;
+    int capacite;
+    unsigned long sequence;
+    int *indices;
+    MPI_Status *statuts;
+    char **reserve;             // Tampons libres de MOTEUR_TAILLE octets
+    int nb_reserve;
+    int cap_reserve;
+    MoteurTraitement traiter;
+    void *ctx;
+} Moteur;
+
+// Tampon de MOTEUR_TAILLE octets pris dans la réserve
+static inline char *moteur_tampon(Moteur *m) {
+    if (m->nb_reserve > 0) return m->reserve[--m->nb_reserve];
+    return (char *)malloc(MOTEUR_TAILLE);
+}
+
+static inline void moteur_rendre(Moteur *m, char *tampon) {
+    if (m->nb_reserve == m->cap_reserve) {
+        m->cap_reserve = m->cap_reserve ? 2 * m->cap_reserve : 16;
+        m->reserve = (char **)realloc(m->reserve, m->cap_reserve * sizeof(char *));
+    }
+    m->reserve[m->nb_reserve++] = tampon;
+}
+
+// Ajoute une requête non bloquante à celles complétées par le moteur
+// A la fin de la requête le tampon (s'il n'est pas NULL) retourne à la réserve et le compteur
+// (s'il n'est pas NULL) est décrémenté ; il est incrémenté ici
+static inline void moteur_suivre(Moteur *m, MPI_Request req, char *tampon, int *compteur) {
+    if (m->nb_requetes == m->capacite) {
+        m->capacite = 2 * m->capacite;
+        m->requetes = (MPI_Request *)realloc(m->requetes, m->capacite * sizeof(MPI_Request));
+        m->tampons = (char **)realloc(m->tampons, m->capacite * sizeof(char *));
+        m->compteurs = (int **)realloc(m->compteurs, m->capacite * sizeof(int *));
+        m->sequences = (unsigned long *)realloc(m->sequences, m->capacite * sizeof(unsigned long));
+        m->indices = (int *)realloc(m->indices, m->capacite * sizeof(int));
+        m->statuts = (MPI_Status *)realloc(m->statuts, m->capacite * sizeof(MPI_Status));
+    }
+    int i = m->nb_requetes++;
+    m->requetes[i] = req;
+    m->tampons[i] = tampon;
+    m->compteurs[i] = compteur;
+    if (compteur != NULL) (*compteur)++;
+}
+
+static inline void moteur_poster(Moteur *m, int i) {
+    m->sequences[i] = m->sequence++;
+    MPI_Irecv(m->tampons[i], MOTEUR_TAILLE, MPI_BYTE, MPI_ANY_SOURCE, MPI_ANY_TAG, m->comm, &m->requetes[i]);
+}
+
+static inline void moteur_init(Moteur *m, MPI_Comm comm, MoteurTraitement traiter, void *ctx) {
+    memset(m, 0, sizeof(Moteur));
+    m->comm = comm;
+    m->traiter = traiter;
+    m->ctx = ctx;
+    m->capacite = 2 * MOTEUR_RECEPTIONS;
+    m->requetes = (MPI_Request *)malloc(m->capacite * sizeof(MPI_Request));
+    m->tampons = (char **)malloc(m->capacite * sizeof(char *));
+    m->compteurs = (int **)malloc(m->capacite * sizeof(int *));
+    m->sequences = (unsigned long *)malloc(m->capacite * sizeof(unsigned long));
+    m->indices = (int *)malloc(m->capacite * sizeof(int));
+    m->statuts = (MPI_Status *)malloc(m->capacite * sizeof(MPI_Status));
+    m->nb_receptions = traiter != NULL ? MOTEUR_RECEPTIONS : 0;
+    for (int i = 0; i < m->nb_receptions; i++) {
+        moteur_suivre(m, MPI_REQUEST_NULL, moteur_tampon(m), NULL);
+        moteur_poster(m, i);
+    }
+}
+
+// Envoie octets du tampon, qui appartient au moteur jusqu'à la fin de l'envoi
+static inline void moteur_envoyer(Moteur *m, char *tampon, int octets, int dest, int tag, int *compteur) {
+    MPI_Request req;
+    stats_isend(tampon, octets, MPI_BYTE, dest, tag, m->comm, &req);
+    moteur_suivre(m, req, tampon, compteur);
+}
+
+// Envoi synchrone : il ne se termine qu'une fois le message reçu par le destinataire
+static inline void moteur_envoyer_synchrone(Moteur *m, char *tampon, int octets, int dest, int tag, int *compteur) {
+    MPI_Request req;
+    stats_issend(tampon, octets, MPI_BYTE, dest, tag, m->comm, &req);
+    moteur_suivre(m, req, tampon, compteur);
+}
+
+static inline unsigned long moteur_ordre(const Moteur *m, int i) {
+    return i < m->nb_receptions ? m->sequences[i] : ~0UL;
+}
+
+// Complète les requêtes terminées et traite les messages reçus
+// En mode bloquant attend qu'au moins une requête se termine
+// Retourne le nombre de requêtes terminées
+static inline int moteur_progresser(Moteur *m, int bloquant) {
+    int nb;
+    if (bloquant) {
+        MPI_Waitsome(m->nb_requetes, m->requetes, &nb, m->indices, m->statuts);
+    } else {
+        MPI_Testsome(m->nb_requetes, m->requetes, &nb, m->indices, m->statuts);
+    }
+    if (nb == MPI_UNDEFINED || nb == 0) return 0;
+
+    // Les réceptions sont traitées dans l'ordre où elles ont été postées, ce qui conserve
+    // l'ordre des messages d'un même envoyeur ; les autres requêtes passent après
+    for (int a = 1; a < nb; a++) {
+        int i = m->indices[a];
+        MPI_Status s = m->statuts[a];
+        int b = a;
+        while (b > 0 && moteur_ordre(m, m->indices[b-1]) > moteur_ordre(m, i)) {
+            m->indices[b] = m->indices[b-1];
+            m->statuts[b] = m->statuts[b-1];
+            b--;
+        }
+        m->indices[b] = i;
+        m->statuts[b] = s;
+    }
+
+    for (int a = 0; a < nb; a++) {
+        int i = m->indices[a];
+        if (i < m->nb_receptions) {
+            int octets;
+            MPI_Get_count(&m->statuts[a], MPI_BYTE, &octets);
+            stats_compter_reception(&m->statuts[a], MPI_BYTE);
+            m->traiter(m->ctx, m->statuts[a].MPI_SOURCE, m->statuts[a].MPI_TAG, m->tampons[i], octets);
+            moteur_poster(m, i);
+        } else {
+            if (m->tampons[i] != NULL) moteur_rendre(m, m->tampons[i]);
+            if (m->compteurs[i] != NULL) (*m->compteurs[i])--;
+        }
+    }
+
+    // Retire les requêtes terminées, les envois ajoutés pendant les traitements sont conservés
+    int j = m->nb_receptions;
+    for (int i = m->nb_receptions; i < m->nb_requetes; i++) {
+        if (m->requetes[i] == MPI_REQUEST_NULL) continue;
+        m->requetes[j] = m->requetes[i];
+        m->tampons[j] = m->tampons[i];
+        m->compteurs[j] = m->compteurs[i];
+        j++;
+    }
+    m->nb_requetes = j;
+    return nb;
+}
+
+// Attend la fin des envois en cours, annule les réceptions postées et libère le moteur
+// A n'appeler qu'une fois le protocole terminé : plus aucun message ne doit être attendu
+static inline void moteur_liberer(Moteur *m) {
+    for (int i = m->nb_receptions; i < m->nb_requetes; i++) {
+        MPI_Wait(&m->requetes[i], MPI_STATUS_IGNORE);
+        free(m->tampons[i]);
+    }
+    for (int i = 0; i < m->nb_receptions; i++) {
+        MPI_Cancel(&m->requetes[i]);
+        MPI_Wait(&m->requetes[i], MPI_STATUS_IGNORE);
+        free(m->tampons[i]);
+    }
+    for (int i = 0; i < m->nb_reserve; i++) {
+        free(m->reserve[i]);
+    }
+    free(m->reserve);
+    free(m->requetes);
+    free(m->tampons);
+    free(m->compteurs);
+    free(m->sequences);
+    free(m->indices);
+    free(m->statuts);
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Pool de threads ouvriers à vol de tâches
+// Chaque ouvrier a sa propre file : il y prend les tâches les plus récentes et, quand elle est vide,
+// vole les plus anciennes dans la file d'un autre ouvrier. Les tâches soumises sont réparties à tour
+// de rôle entre les files, un ouvrier inoccupé dort jusqu'à la prochaine soumission
+// Une tâche traite la plage [debut, fin[ d'un argument partagé, ce qui permet de découper un travail
+
+// Traitement d'une tâche par l'ouvrier dont le contexte est passé en premier
+typedef void (*PoolFonction)(void *ouvrier, void *arg, int debut, int fin);
+// Appelé quand l'ouvrier ne trouve aucune tâche, retourne 1 s'il lui reste du travail en cours
+typedef int (*PoolInactif)(void *ouvrier);
+
+typedef struct {
+    PoolFonction fonction;
+    void *arg;
+    int debut;
+    int fin;
+} Tache;
+
+// File circulaire d'un ouvrier, protégée par son verrou
+typedef struct {
+    pthread_mutex_t verrou;
+    Tache *taches;
+    int premiere;
+    int nb;
+    int capacite;
+} FileTaches;
+
+typedef struct Pool Pool;
+
+typedef struct {
+    Pool *pool;
+    int indice;
+} PoolThread;
+
+struct Pool {
+    int nb_ouvriers;
+    FileTaches *files;
+    void **ouvriers;            // Contexte de chaque ouvrier
+    PoolInactif inactif;
+    pthread_t *threads;
+    PoolThread *infos;
+    pthread_mutex_t verrou;     // Protège l'attente des ouvriers et du thread qui soumet
+    pthread_cond_t travail;
+    pthread_cond_t fini;
+    int en_file;                // Tâches soumises pas encore prises
+    int en_cours;               // Tâches soumises pas encore terminées
+    int arret;
+    int suivante;               // File qui recevra la prochaine soumission
+};
+
+static inline void file_ajouter(FileTaches *f, const Tache *t) {
+    pthread_mutex_lock(&f->verrou);
+    if (f->nb == f->capacite) {
+        int capacite = f->capacite ? 2 * f->capacite : 64;
+        Tache *taches = (Tache *)malloc(capacite * sizeof(Tache));
+        for (int k = 0; k < f->nb; k++) {
+            taches[k] = f->taches[(f->premiere + k) % f->capacite];
+        }
+        free(f->taches);
+        f->taches = taches;
+        f->premiere = 0;
+        f->capacite = capacite;
+    }
+    f->taches[(f->premiere + f->nb) % f->capacite] = *t;
+    __atomic_store_n(&f->nb, f->nb + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&f->verrou);
+}
+
+// Retire la tâche la plus récente (propriétaire) ou la plus ancienne (vol)
+static inline int file_retirer(FileTaches *f, Tache *t, int vol) {
+    if (__atomic_load_n(&f->nb, __ATOMIC_RELAXED) == 0) return 0;
+    pthread_mutex_lock(&f->verrou);
+    int trouve = f->nb > 0;
+    if (trouve) {
+        if (vol) {
+            *t = f->taches[f->premiere];
+            f->premiere = (f->premiere + 1) % f->capacite;
+        } else {
+            *t = f->taches[(f->premiere + f->nb - 1) % f->capacite];
+        }
+        __atomic_store_n(&f->nb, f->nb - 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&f->verrou);
+    return trouve;
+}
+
+// Cherche une tâche dans la file de l'ouvrier, puis dans celles des autres
+static inline int pool_prendre(Pool *pool, int indice, Tache *t) {
+    if (file_retirer(&pool->files[indice], t, 0)) return 1;
+    for (int k = 1; k < pool->nb_ouvriers; k++) {
+        if (file_retirer(&pool->files[(indice + k) % pool->nb_ouvriers], t, 1)) return 1;
+    }
+    return 0;
+}
+
+static inline void *pool_ouvrier(void *arg) {
+    PoolThread *info = (PoolThread *)arg;
+    Pool *pool = info->pool;
+    void *ouvrier = pool->ouvriers[info->indice];
+    Tache t;
+
+    for (;;) {
+        if (pool_prendre(pool, info->indice, &t)) {
+            __atomic_sub_fetch(&pool->en_file, 1, __ATOMIC_RELAXED);
+            t.fonction(ouvrier, t.arg, t.debut, t.fin);
+            if (__atomic_sub_fetch(&pool->en_cours, 1, __ATOMIC_ACQ_REL) == 0) {
+                pthread_mutex_lock(&pool->verrou);
+                pthread_cond_broadcast(&pool->fini);
+                pthread_mutex_unlock(&pool->verrou);
+            }
+            continue;
+        }
+        if (pool->inactif != NULL && pool->inactif(ouvrier)) {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->verrou);
+        while (__atomic_load_n(&pool->en_file, __ATOMIC_ACQUIRE) == 0 && !pool->arret) {
+            pthread_cond_wait(&pool->travail, &pool->verrou);
+        }
+        int arret = pool->arret && __atomic_load_n(&pool->en_file, __ATOMIC_ACQUIRE) == 0;
+        pthread_mutex_unlock(&pool->verrou);
+        if (arret) return NULL;
+    }
+}
+
+// Démarre nb_ouvriers threads, ouvriers[k] étant le contexte passé aux tâches du k-ième
+static inline void pool_demarrer(Pool *pool, int nb_ouvriers, void **ouvriers, PoolInactif inactif) {
+    memset(pool, 0, sizeof(Pool));
+    pool->nb_ouvriers = nb_ouvriers;
+    pool->ouvriers = ouvriers;
+    pool->inactif = inactif;
+    pool->files = (FileTaches *)calloc(nb_ouvriers, sizeof(FileTaches));
+    pool->threads = (pthread_t *)malloc(nb_ouvriers * sizeof(pthread_t));
+    pool->infos = (PoolThread *)malloc(nb_ouvriers * sizeof(PoolThread));
+    pthread_mutex_init(&pool->verrou, NULL);
+    pthread_cond_init(&pool->travail, NULL);
+    pthread_cond_init(&pool->fini, NULL);
+    for (int k = 0; k < nb_ouvriers; k++) {
+        pthread_mutex_init(&pool->files[k].verrou, NULL);
+    }
+    for (int k = 0; k < nb_ouvriers; k++) {
+        pool->infos[k].pool = pool;
+        pool->infos[k].indice = k;
+        pthread_create(&pool->threads[k], NULL, pool_ouvrier, &pool->infos[k]);
+    }
+}
+
+static inline void pool_soumettre(Pool *pool, PoolFonction fonction, void *arg, int debut, int fin) {
+    Tache t = { fonction, arg, debut, fin };
+    file_ajouter(&pool->files[pool->suivante], &t);
+    pool->suivante = (pool->suivante + 1) % pool->nb_ouvriers;
+    __atomic_add_fetch(&pool->en_cours, 1, __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&pool->en_file, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&pool->verrou);
+    pthread_cond_signal(&pool->travail);
+    pthread_mutex_unlock(&pool->verrou);
+}
+
+// Attend que toutes les tâches soumises soient terminées
+static inline void pool_attendre(Pool *pool) {
+    if (__atomic_load_n(&pool->en_cours, __ATOMIC_ACQUIRE) == 0) return;
+    pthread_mutex_lock(&pool->verrou);
+    while (__atomic_load_n(&pool->en_cours, __ATOMIC_ACQUIRE) > 0) {
+        pthread_cond_wait(&pool->fini, &pool->verrou);
+    }
+    pthread_mutex_unlock(&pool->verrou);
+}
+
+// Termine les tâches restantes et le travail en cours des ouvriers, puis arrête les threads
+static inline void pool_arreter(Pool *pool) {
+    pthread_mutex_lock(&pool->verrou);
+    pool->arret = 1;
+    pthread_cond_broadcast(&pool->travail);
+    pthread_mutex_unlock(&pool->verrou);
+    for (int k = 0; k < pool->nb_ouvriers; k++) {
+        pthread_join(pool->threads[k], NULL);
+        pthread_mutex_destroy(&pool->files[k].verrou);
+        free(pool->files[k].taches);
+    }
+    pthread_mutex_destroy(&pool->verrou);
+    pthread_cond_destroy(&pool->travail);
+    pthread_cond_destroy(&pool->fini);
+    free(pool->files);
+    free(pool->threads);
+    free(pool->infos);
+}
+
+#endif
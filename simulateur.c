@@ -0,0 +1,517 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chord.h"
+
+// Simulateur à événements discrets de l'anneau CHORD, dans un seul processus et sans MPI
+// Les pairs sont rangés dans des tableaux contigus indexés par leur place, dans l'ordre de création :
+// id, prédécesseur, finger table (M ids par pair), charge. Les messages sont des événements datés d'une
+// file de priorité, leur délai suit un modèle de latence, et chaque pair traite ses messages un par un
+// en un temps de service fixe. Le routage est celui de ex1 : un pair répond s'il possède la clé, sinon
+// find_next choisit le finger suivant ; les joins suivent le protocole de ex3.txt
+
+/********** ANNEAU **********/
+
+typedef struct {
+    int nb_pairs;           // Pairs dans l'anneau
+    int capacite;
+    cle_t *ids;             // Indexés par place
+    cle_t *preds;
+    cle_t *fingers;         // M par place
+    uint32_t *charges;      // Messages traités par chaque pair
+    double *libre;          // Fin du dernier message pris en charge par chaque pair
+    uint32_t *marques;      // Pairs déjà mis à jour par le join en cours
+    cle_t *ids_tries;       // Ids des pairs de l'anneau, triés
+    int *rangs_tries;       // Place + 1 de chacun, comme les rangs de chord.h
+} Anneau;
+
+// Place du pair de l'anneau qui a cet id
+static inline int anneau_place(const Anneau *a, cle_t id) {
+    return a->rangs_tries[successeur_trie(a->ids_tries, a->nb_pairs, id)] - 1;
+}
+
+// Id du pair responsable de la clé, d'après l'anneau trié
+static inline cle_t anneau_responsable(const Anneau *a, cle_t key) {
+    return a->ids_tries[successeur_trie(a->ids_tries, a->nb_pairs, key)];
+}
+
+// Etape du routage de la clé par le pair de la place p, comme lookup dans ex1
+// Retourne 1 si la clé est résolue avec son responsable dans *responsable, sinon 0 avec la place du
+// finger suivant dans *suivant
+static inline int router(const Anneau *a, int p, cle_t key, cle_t *responsable, int *suivant) {
+    if (cle_dans_intervalle(key, a->preds[p], a->ids[p])) {
+        *responsable = a->ids[p];
+        return 1;
+    }
+    const cle_t *finger_table = a->fingers + (size_t)p * M;
+    int next = find_next(a->ids[p], finger_table, key);
+    if (next == -1) {
+        // Le successeur possède la clé
+        *responsable = finger_table[0];
+        return 1;
+    }
+    *suivant = anneau_place(a, finger_table[next]);
+    return 0;
+}
+
+// Routage complet depuis la place p, retourne le responsable et compte les sauts
+cle_t router_tout(const Anneau *a, int p, cle_t key, int *hops) {
+    cle_t responsable;
+    *hops = 0;
+    while (!router(a, p, key, &responsable, &p)) {
+        (*hops)++;
+    }
+    return responsable;
+}
+
+// Anneau initial des nb_initiaux premiers pairs, les suivants le rejoindront par un join
+void anneau_init(Anneau *a, const cle_t *identifiers, int nb_total, int nb_initiaux) {
+    memset(a, 0, sizeof(Anneau));
+    a->capacite = nb_total;
+    a->nb_pairs = nb_initiaux;
+    a->ids = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    a->preds = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    a->fingers = (cle_t *)fingers_allouer((size_t)nb_total * M * sizeof(cle_t));
+    a->charges = (uint32_t *)calloc(nb_total, sizeof(uint32_t));
+    a->libre = (double *)calloc(nb_total, sizeof(double));
+    a->marques = (uint32_t *)calloc(nb_total, sizeof(uint32_t));
+    a->ids_tries = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    a->rangs_tries = (int *)malloc(nb_total * sizeof(int));
+    memcpy(a->ids, identifiers, nb_total * sizeof(cle_t));
+
+    trier_identifiants(identifiers, nb_initiaux, a->ids_tries, a->rangs_tries);
+    for (int j = 0; j < nb_initiaux; j++) {
+        a->preds[a->rangs_tries[j] - 1] = a->ids_tries[(j - 1 + nb_initiaux) % nb_initiaux];
+    }
+    calculer_finger_tables(a->ids_tries, a->rangs_tries, nb_initiaux, a->fingers, NULL);
+}
+
+void anneau_liberer(Anneau *a) {
+    free(a->ids);
+    free(a->preds);
+    free(a->fingers);
+    free(a->charges);
+    free(a->libre);
+    free(a->marques);
+    free(a->ids_tries);
+    free(a->rangs_tries);
+}
+
+// Octets occupés par pair
+static inline size_t anneau_octets_par_pair(void) {
+    return (M + 3) * sizeof(cle_t) + 2 * sizeof(uint32_t) + sizeof(double) + sizeof(int);
+}
+
+/********** JOIN **********/
+
+// Messages d'un join par étape de ex3.txt, comptés comme dans ex1
+typedef struct {
+    int messages[4];
+    int lookups;
+} BilanJoin;
+
+// Le pair de la place p rejoint l'anneau en passant par le membre de la place init
+// 1. lookup de son id, 2. raccordement entre prédécesseur et successeur, 3. finger table cherchée à
+// partir de celle du successeur, 4. mise à jour des pairs dont un finger doit le désigner
+void joindre(Anneau *a, int p, int init, BilanJoin *b) {
+    cle_t id = a->ids[p];
+    cle_t *finger_table = a->fingers + (size_t)p * M;
+    int hops;
+    memset(b, 0, sizeof(BilanJoin));
+
+    // Etape 1 : lookup et réponse
+    cle_t succ = router_tout(a, init, id, &hops);
+    b->messages[0] = hops + 1;
+
+    // Etape 2 : JOIN_PRED, JOIN_INFOS, JOIN_SUCC et JOIN_ACK ; le pair entre dans l'anneau trié
+    int s = anneau_place(a, succ);
+    cle_t pred = a->preds[s];
+    int q = anneau_place(a, pred);
+    a->preds[p] = pred;
+    a->preds[s] = id;
+    a->fingers[(size_t)q * M] = id;
+    b->messages[1] = 4;
+    int j = successeur_trie(a->ids_tries, a->nb_pairs, id);
+    if (cle_cmp(a->ids_tries[j], id) < 0) j = a->nb_pairs;
+    memmove(a->ids_tries + j + 1, a->ids_tries + j, (a->nb_pairs - j) * sizeof(cle_t));
+    memmove(a->rangs_tries + j + 1, a->rangs_tries + j, (a->nb_pairs - j) * sizeof(int));
+    a->ids_tries[j] = id;
+    a->rangs_tries[j] = p + 1;
+    a->nb_pairs++;
+
+    // Etape 3 : une entrée dont la cible précède le finger précédent s'en déduit sans message, les autres
+    // sont cherchées à partir du finger correspondant du successeur
+    const cle_t *guess = a->fingers + (size_t)s * M;
+    finger_table[0] = succ;
+    for (int i = 1; i < M; i++) {
+        cle_t cible = cle_ajoute_puissance2(id, i);
+        if (cle_dans_intervalle(cible, id, finger_table[i-1])) {
+            finger_table[i] = finger_table[i-1];
+            continue;
+        }
+        finger_table[i] = router_tout(a, anneau_place(a, guess[i]), cible, &hops);
+        b->messages[2] += hops + 2;
+        b->lookups++;
+    }
+
+    // Etape 4 : les pairs dont la cible de l'entrée i tombe dans ]pred, id] sont ceux de ]pred - 2^i, id - 2^i]
+    // Chacun reçoit une mise à jour pour toutes ses entrées concernées, et la confirme
+    static uint32_t join_courant = 0;
+    join_courant++;
+    cle_t zero = cle_depuis_u64(0);
+    for (int i = 0; i < M; i++) {
+        cle_t puissance = cle_ajoute_puissance2(zero, i);
+        cle_t debut = cle_distance(puissance, pred);
+        cle_t fin = cle_distance(puissance, id);
+        int k = successeur_trie(a->ids_tries, a->nb_pairs, debut);
+        for (int n = 0; n < a->nb_pairs; n++, k = (k + 1) % a->nb_pairs) {
+            cle_t x = a->ids_tries[k];
+            if (cle_egal(x, debut)) continue;
+            if (!cle_dans_intervalle(x, debut, fin) || cle_egal(debut, fin)) break;
+            int r = a->rangs_tries[k] - 1;
+            if (r == p || cle_egal(a->fingers[(size_t)r * M + i], id)) continue;
+            a->fingers[(size_t)r * M + i] = id;
+            if (a->marques[r] != join_courant) {
+                a->marques[r] = join_courant;
+                b->messages[3] += 2;
+            }
+        }
+    }
+}
+
+/********** EVENEMENTS **********/
+
+// Modèle de latence : délai fixe plus un délai exponentiel, et temps de service de chaque message par un pair
+typedef struct {
+    double latence;
+    double gigue;           // Moyenne du délai exponentiel
+    double service;
+    uint64_t alea;          // Etat du générateur xorshift64*
+} Modele;
+
+static inline uint64_t alea_suivant(uint64_t *etat) {
+    uint64_t x = *etat;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *etat = x;
+    return x * UINT64_C(0x2545F4914F6CDD1D);
+}
+
+// Nombre uniforme dans ]0, 1]
+static inline double alea_uniforme(uint64_t *etat) {
+    return ((alea_suivant(etat) >> 11) + 1) * 0x1.0p-53;
+}
+
+static inline double modele_delai(Modele *m) {
+    if (m->gigue == 0) return m->latence;
+    return m->latence - m->gigue * log(alea_uniforme(&m->alea));
+}
+
+// Arrivée d'un lookup sur le pair de la place, ou de sa réponse à l'origine si place vaut -1
+typedef struct {
+    double temps;
+    int lookup;             // Indice dans la fenêtre des lookups en vol
+    int place;
+} Evenement;
+
+// Tas binaire d'événements, le plus ancien en tête
+typedef struct {
+    Evenement *tas;
+    int nb;
+} File;
+
+static inline void file_ajouter(File *f, double temps, int lookup, int place) {
+    int i = f->nb++;
+    while (i > 0 && f->tas[(i - 1) / 2].temps > temps) {
+        f->tas[i] = f->tas[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    f->tas[i].temps = temps;
+    f->tas[i].lookup = lookup;
+    f->tas[i].place = place;
+}
+
+static inline Evenement file_retirer(File *f) {
+    Evenement tete = f->tas[0];
+    Evenement dernier = f->tas[--f->nb];
+    int i = 0;
+    for (;;) {
+        int fils = 2 * i + 1;
+        if (fils >= f->nb) break;
+        if (fils + 1 < f->nb && f->tas[fils + 1].temps < f->tas[fils].temps) fils++;
+        if (f->tas[fils].temps >= dernier.temps) break;
+        f->tas[i] = f->tas[fils];
+        i = fils;
+    }
+    f->tas[i] = dernier;
+    return tete;
+}
+
+/********** LOOKUPS **********/
+
+// Latences rangées par tranches de 1% : la mémoire ne dépend pas du nombre de lookups
+#define LATENCE_TRANCHES 4096
+#define LATENCE_PAS 0.01
+
+typedef struct {
+    cle_t key;
+    double debut;
+    int hops;
+} LookupEnVol;
+
+typedef struct {
+    long long lookups;
+    long long evenements;
+    long long erreurs;
+    long long *hops;        // Histogramme, 2*M+2 cases
+    long long *latences;    // Histogramme par tranches de LATENCE_PAS en échelle log des microsecondes
+    double somme_hops;
+    double somme_latences;
+    double max_latence;
+    double duree;           // Temps simulé
+} BilanLookups;
+
+static inline int latence_tranche(double latence) {
+    int t = (int)(log1p(1e6 * latence) / LATENCE_PAS);
+    return t < LATENCE_TRANCHES ? t : LATENCE_TRANCHES - 1;
+}
+
+static inline double tranche_latence(int t) {
+    return expm1((t + 1) * LATENCE_PAS) * 1e-6;
+}
+
+// Lance le lookup numéro i dans la case w de la fenêtre, à partir d'un pair tiré au hasard
+static void lookup_lancer(const Anneau *a, Modele *m, File *f, LookupEnVol *vol, int w, long long i,
+                          unsigned graine, double maintenant) {
+    uint64_t valeur[2] = { graine, (uint64_t)i };
+    vol[w].key = hash_cle(valeur, sizeof(valeur));
+    vol[w].debut = maintenant;
+    vol[w].hops = 0;
+    int entree = a->rangs_tries[alea_suivant(&m->alea) % a->nb_pairs] - 1;
+    file_ajouter(f, maintenant + modele_delai(m), w, entree);
+}
+
+// nb_lookups lookups récursifs, au plus fenetre en vol : chaque réponse reçue en lance un nouveau
+void simuler_lookups(Anneau *a, Modele *m, long long nb_lookups, int fenetre, unsigned graine, BilanLookups *b) {
+    memset(b, 0, sizeof(BilanLookups));
+    b->hops = (long long *)calloc(2 * M + 2, sizeof(long long));
+    b->latences = (long long *)calloc(LATENCE_TRANCHES, sizeof(long long));
+    if (fenetre > nb_lookups) fenetre = (int)nb_lookups;
+    File f = { (Evenement *)malloc(fenetre * sizeof(Evenement)), 0 };
+    LookupEnVol *vol = (LookupEnVol *)malloc(fenetre * sizeof(LookupEnVol));
+
+    long long lances = 0;
+    for (int w = 0; w < fenetre; w++) {
+        lookup_lancer(a, m, &f, vol, w, lances++, graine, 0);
+    }
+
+    while (f.nb > 0) {
+        Evenement e = file_retirer(&f);
+        LookupEnVol *l = &vol[e.lookup];
+        b->evenements++;
+
+        if (e.place == -1) {
+            // Réponse reçue par l'origine
+            double latence = e.temps - l->debut;
+            b->lookups++;
+            b->hops[l->hops < 2 * M + 1 ? l->hops : 2 * M + 1]++;
+            b->latences[latence_tranche(latence)]++;
+            b->somme_hops += l->hops;
+            b->somme_latences += latence;
+            if (latence > b->max_latence) b->max_latence = latence;
+            b->duree = e.temps;
+            if (lances < nb_lookups) lookup_lancer(a, m, &f, vol, e.lookup, lances++, graine, e.temps);
+            continue;
+        }
+
+        // Le pair traite les messages dans l'ordre d'arrivée
+        int p = e.place;
+        a->charges[p]++;
+        double debut = e.temps > a->libre[p] ? e.temps : a->libre[p];
+        a->libre[p] = debut + m->service;
+
+        cle_t responsable;
+        int suivant;
+        if (router(a, p, l->key, &responsable, &suivant)) {
+            if (!cle_egal(responsable, anneau_responsable(a, l->key))) b->erreurs++;
+            file_ajouter(&f, a->libre[p] + modele_delai(m), e.lookup, -1);
+        } else {
+            l->hops++;
+            file_ajouter(&f, a->libre[p] + modele_delai(m), e.lookup, suivant);
+        }
+    }
+
+    free(f.tas);
+    free(vol);
+}
+
+// Percentile q du nombre de sauts et de la latence d'après les histogrammes
+static int percentile_hops(const BilanLookups *b, double q) {
+    long long cumul = 0;
+    for (int h = 0; h < 2 * M + 2; h++) {
+        cumul += b->hops[h];
+        if (cumul > q * b->lookups) return h;
+    }
+    return 2 * M + 1;
+}
+
+static double percentile_latence(const BilanLookups *b, double q) {
+    long long cumul = 0;
+    for (int t = 0; t < LATENCE_TRANCHES; t++) {
+        cumul += b->latences[t];
+        if (cumul > q * b->lookups) return tranche_latence(t);
+    }
+    return b->max_latence;
+}
+
+void afficher_lookups(const Anneau *a, const BilanLookups *b, double secondes) {
+    int max_hops = 0;
+    for (int h = 0; h < 2 * M + 2; h++) {
+        if (b->hops[h] > 0) max_hops = h;
+    }
+    uint32_t charge_max = 0;
+    for (int j = 0; j < a->nb_pairs; j++) {
+        uint32_t c = a->charges[a->rangs_tries[j] - 1];
+        if (c > charge_max) charge_max = c;
+    }
+    double charge_moyenne = (double)(b->evenements - b->lookups) / a->nb_pairs;
+
+    printf("\n************************ BENCHMARK ************************\n");
+    printf("Pairs: %d, lookups: %lld, log2(N) = %.2f\n", a->nb_pairs, b->lookups, log2(a->nb_pairs));
+    printf("Sauts   : moyenne %.2f, p50 %d, p99 %d, max %d\n",
+           b->somme_hops / b->lookups, percentile_hops(b, 0.5), percentile_hops(b, 0.99), max_hops);
+    printf("Latence : moyenne %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           1e6 * b->somme_latences / b->lookups, 1e6 * percentile_latence(b, 0.5),
+           1e6 * percentile_latence(b, 0.99), 1e6 * b->max_latence);
+    printf("Débit   : %.0f lookups par seconde simulée\n", b->lookups / b->duree);
+    printf("Charge  : %.1f messages par pair en moyenne, %u au plus (%.2f fois la moyenne)\n",
+           charge_moyenne, charge_max, charge_moyenne > 0 ? charge_max / charge_moyenne : 0.0);
+    printf("Histogramme des sauts :\n");
+    for (int h = 0; h <= max_hops; h++) {
+        printf("  %3d : %10lld (%5.1f%%)\n", h, b->hops[h], 100.0 * b->hops[h] / b->lookups);
+    }
+    printf("Simulateur: %lld erreurs de routage, %lld événements en %.2f s (%.2f millions par seconde)\n",
+           b->erreurs, b->evenements, secondes, b->evenements / secondes / 1e6);
+}
+
+static double horloge(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    // Options : -n nombre de pairs, -j nombre de pairs qui rejoignent l'anneau un par un
+    //           -l nombre de lookups, -w nombre max de lookups en vol, -s graine
+    //           -d latence d'un message en us, -g moyenne du délai exponentiel ajouté en us
+    //           -t temps de service d'un message par un pair en us
+    int nb_total = 1000;
+    int nb_joins = 0;
+    long long nb_lookups = 10000;
+    int fenetre = 1024;
+    unsigned graine = (unsigned)time(NULL);
+    Modele modele = { 50e-6, 0, 0, 0 };
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:l:w:s:d:g:t:")) != -1) {
+        switch (opt) {
+            case 'n': nb_total = atoi(optarg); break;
+            case 'j': nb_joins = atoi(optarg); break;
+            case 'l': nb_lookups = atoll(optarg); break;
+            case 'w': fenetre = atoi(optarg); break;
+            case 's': graine = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'd': modele.latence = atof(optarg) * 1e-6; break;
+            case 'g': modele.gigue = atof(optarg) * 1e-6; break;
+            case 't': modele.service = atof(optarg) * 1e-6; break;
+            default:
+                fprintf(stderr, "Usage: %s [-n nb_pairs] [-j nb_joins] [-l nb_lookups] [-w fenetre] [-s graine] [-d latence_us] [-g gigue_us] [-t service_us]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int nb_initiaux = nb_total - nb_joins;
+    if (nb_joins < 0 || nb_initiaux < 1 || nb_lookups < 0 || fenetre < 1
+            || modele.latence < 0 || modele.gigue < 0 || modele.service < 0) {
+        fprintf(stderr, "Erreur: paramètres invalides\n");
+        return 1;
+    }
+#if M < 31
+    if ((long)nb_total > (1L << M)) {
+        fprintf(stderr, "Erreur: %d pairs pour un espace de 2^%d identifiants\n", nb_total, M);
+        return 1;
+    }
+#endif
+    modele.alea = graine * UINT64_C(0x9E3779B97F4A7C15) + 1;
+
+    printf("******************** INITIALISATION ********************\n");
+    double debut = horloge();
+    cle_t *identifiers = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    cle_t *ids_tries = (cle_t *)malloc(nb_total * sizeof(cle_t));
+    int *rangs_tries = (int *)malloc(nb_total * sizeof(int));
+    srand(graine);
+    generer_identifiants(identifiers, nb_total, ids_tries, rangs_tries);
+    free(ids_tries);
+    free(rangs_tries);
+
+    Anneau anneau;
+    anneau_init(&anneau, identifiers, nb_total, nb_initiaux);
+    free(identifiers);
+    printf("Simulateur: %d pairs, M = %d, %.1f Mo pour l'anneau, initialisé en %.2f s\n", nb_initiaux, M,
+           nb_total * anneau_octets_par_pair() / 1e6, horloge() - debut);
+
+    if (nb_joins > 0) {
+        printf("\n\n************************* JOIN *************************\n");
+        debut = horloge();
+        long long total[4] = { 0, 0, 0, 0 }, lookups = 0;
+        int max_messages = 0;
+        for (int p = nb_initiaux; p < nb_total; p++) {
+            BilanJoin b;
+            int init = anneau.rangs_tries[rand() % anneau.nb_pairs] - 1;
+            joindre(&anneau, p, init, &b);
+            int messages = 0;
+            for (int e = 0; e < 4; e++) {
+                total[e] += b.messages[e];
+                messages += b.messages[e];
+            }
+            lookups += b.lookups;
+            if (messages > max_messages) max_messages = messages;
+        }
+        double log_n = log2(nb_total);
+        printf("Simulateur: %d joins, %.1f messages par join en moyenne (max %d), en %.2f s\n", nb_joins,
+               (double)(total[0] + total[1] + total[2] + total[3]) / nb_joins, max_messages, horloge() - debut);
+        printf("  successeur %.1f, raccordement %.1f, finger table %.1f (%.1f lookups sur M = %d), mises à jour %.1f\n",
+               (double)total[0] / nb_joins, (double)total[1] / nb_joins, (double)total[2] / nb_joins,
+               (double)lookups / nb_joins, M, (double)total[3] / nb_joins);
+        printf("  log2(N)^2 = %.1f, M * log2(N) = %.1f\n", log_n * log_n, M * log_n);
+
+        // Les finger tables obtenues par les joins doivent être celles de l'anneau complet
+        long long fausses = 0;
+        for (int j = 0; j < anneau.nb_pairs; j++) {
+            int p = anneau.rangs_tries[j] - 1;
+            for (int i = 0; i < M; i++) {
+                cle_t attendu = anneau_responsable(&anneau, cle_ajoute_puissance2(anneau.ids[p], i));
+                fausses += !cle_egal(anneau.fingers[(size_t)p * M + i], attendu);
+            }
+            fausses += !cle_egal(anneau.preds[p], anneau.ids_tries[(j - 1 + anneau.nb_pairs) % anneau.nb_pairs]);
+        }
+        printf("Simulateur: %lld entrées fausses après les joins\n", fausses);
+    }
+
+    if (nb_lookups > 0) {
+        printf("\n\n************************ LOOKUP ************************\n");
+        BilanLookups bilan;
+        debut = horloge();
+        simuler_lookups(&anneau, &modele, nb_lookups, fenetre, graine, &bilan);
+        afficher_lookups(&anneau, &bilan, horloge() - debut);
+        free(bilan.hops);
+        free(bilan.latences);
+    }
+
+    anneau_liberer(&anneau);
+    return 0;
+}
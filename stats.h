@@ -0,0 +1,147 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <mpi.h>
+#include <stdio.h>
+#include <string.h>
+
+// Instrumentation des échanges MPI : nombre de messages et d'octets par tag, durée des phases
+// Les fonctions stats_* s'utilisent à la place des appels MPI correspondants
+// Les compteurs sont incrémentés de manière atomique, les threads d'un même processus peuvent les partager
+
+#define STATS_NB_TAGS 32                        // Tags suivis individuellement
+#define STATS_TAG_COLLECTIVE (STATS_NB_TAGS-1)  // Pseudo tag regroupant les collectives
+#define STATS_NB_PHASES 16
+
+typedef struct {
+    long long messages_envoyes[STATS_NB_TAGS];
+    long long octets_envoyes[STATS_NB_TAGS];
+    long long messages_recus[STATS_NB_TAGS];
+    long long octets_recus[STATS_NB_TAGS];
+    double duree_phase[STATS_NB_PHASES];
+    double debut_phase[STATS_NB_PHASES];
+    const char *nom_tag[STATS_NB_TAGS];
+    const char *nom_phase[STATS_NB_PHASES];
+} Stats;
+
+static Stats stats;
+
+static inline void stats_nommer_tag(int tag, const char *nom) {
+    stats.nom_tag[tag] = nom;
+}
+
+static inline void stats_nommer_phase(int phase, const char *nom) {
+    stats.nom_phase[phase] = nom;
+}
+
+static inline int stats_index(int tag) {
+    return tag >= 0 && tag < STATS_TAG_COLLECTIVE ? tag : STATS_TAG_COLLECTIVE;
+}
+
+static inline void stats_compter_envoi(int count, MPI_Datatype type, int tag) {
+    int taille;
+    MPI_Type_size(type, &taille);
+    __atomic_add_fetch(&stats.messages_envoyes[stats_index(tag)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.octets_envoyes[stats_index(tag)], (long long)count * taille, __ATOMIC_RELAXED);
+}
+
+static inline void stats_compter_reception(MPI_Status *status, MPI_Datatype type) {
+    int count, taille;
+    MPI_Get_count(status, type, &count);
+    MPI_Type_size(type, &taille);
+    __atomic_add_fetch(&stats.messages_recus[stats_index(status->MPI_TAG)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats.octets_recus[stats_index(status->MPI_TAG)], (long long)count * taille, __ATOMIC_RELAXED);
+}
+
+/********** ENVELOPPES MPI **********/
+
+static inline int stats_send(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+    stats_compter_envoi(count, type, tag);
+    return MPI_Send(buf, count, type, dest, tag, comm);
+}
+
+static inline int stats_isend(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request *req) {
+    stats_compter_envoi(count, type, tag);
+    return MPI_Isend(buf, count, type, dest, tag, comm, req);
+}
+
+static inline int stats_issend(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request *req) {
+    stats_compter_envoi(count, type, tag);
+    return MPI_Issend(buf, count, type, dest, tag, comm, req);
+}
+
+static inline int stats_recv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Status *status) {
+    MPI_Status local;
+    if (status == MPI_STATUS_IGNORE) status = &local;
+    int err = MPI_Recv(buf, count, type, source, tag, comm, status);
+    stats_compter_reception(status, type);
+    return err;
+}
+
+static inline int stats_sendrecv(const void *envoi, int nb_envoi, MPI_Datatype type_envoi, int dest, int tag_envoi,
+                                 void *recu, int nb_recu, MPI_Datatype type_recu, int source, int tag_recu,
+                                 MPI_Comm comm, MPI_Status *status) {
+    MPI_Status local;
+    if (status == MPI_STATUS_IGNORE) status = &local;
+    stats_compter_envoi(nb_envoi, type_envoi, tag_envoi);
+    int err = MPI_Sendrecv(envoi, nb_envoi, type_envoi, dest, tag_envoi, recu, nb_recu, type_recu, source, tag_recu, comm, status);
+    stats_compter_reception(status, type_recu);
+    return err;
+}
+
+// Les collectives sont comptées une fois par appel avec le volume fourni par le processus
+static inline void stats_collective(int count, MPI_Datatype type) {
+    stats_compter_envoi(count, type, STATS_TAG_COLLECTIVE);
+}
+
+/********** PHASES **********/
+
+static inline void stats_phase_debut(int phase) {
+    stats.debut_phase[phase] = MPI_Wtime();
+}
+
+// Retourne la durée de la phase qui vient de se terminer
+static inline double stats_phase_fin(int phase) {
+    double duree = MPI_Wtime() - stats.debut_phase[phase];
+    stats.duree_phase[phase] += duree;
+    return duree;
+}
+
+/********** RAPPORT **********/
+
+// Réduit les compteurs de tous les processus vers le rang 0 qui écrit un rapport CSV
+// Les messages et octets sont sommés, la durée d'une phase est la plus longue parmi les processus
+static inline void stats_rapport(const char *fichier, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    Stats total;
+    MPI_Reduce(stats.messages_envoyes, total.messages_envoyes, STATS_NB_TAGS, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(stats.octets_envoyes, total.octets_envoyes, STATS_NB_TAGS, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(stats.messages_recus, total.messages_recus, STATS_NB_TAGS, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(stats.octets_recus, total.octets_recus, STATS_NB_TAGS, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(stats.duree_phase, total.duree_phase, STATS_NB_PHASES, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (rank != 0) return;
+
+    FILE *f = strcmp(fichier, "-") == 0 ? stdout : fopen(fichier, "w");
+    if (f == NULL) {
+        perror(fichier);
+        return;
+    }
+
+    fprintf(f, "categorie,nom,messages_envoyes,octets_envoyes,messages_recus,octets_recus,secondes\n");
+    for (int t = 0; t < STATS_NB_TAGS; t++) {
+        if (total.messages_envoyes[t] == 0 && total.messages_recus[t] == 0) continue;
+        const char *nom = t == STATS_TAG_COLLECTIVE ? "COLLECTIVES" : stats.nom_tag[t];
+        fprintf(f, "tag,%s,%lld,%lld,%lld,%lld,\n", nom ? nom : "?",
+                total.messages_envoyes[t], total.octets_envoyes[t], total.messages_recus[t], total.octets_recus[t]);
+    }
+    for (int p = 0; p < STATS_NB_PHASES; p++) {
+        if (stats.nom_phase[p] == NULL) continue;
+        fprintf(f, "phase,%s,,,,,%.6f\n", stats.nom_phase[p], total.duree_phase[p]);
+    }
+
+    if (f != stdout) fclose(f);
+}
+
+#endif
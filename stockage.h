@@ -0,0 +1,192 @@
+#ifndef STOCKAGE_H
+#define STOCKAGE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chord.h"
+
+// Table clé/valeur locale d'un pair
+// Les entrées sont rangées dans un tableau à adressage ouvert (sondage linéaire) de petites cases
+// de taille fixe : une recherche parcourt quelques cases contiguës sans suivre de pointeur
+// Les clés et valeurs, de taille variable, sont stockées bout à bout dans une arène ;
+// les enregistrements remplacés ou supprimés y laissent des trous qui sont récupérés par compactage
+// plutôt que rendus un par un au tas
+
+#define STOCKAGE_VIDE 0         // Empreinte d'une case jamais utilisée
+#define STOCKAGE_SUPPRIME 1     // Empreinte d'une case dont l'entrée a été supprimée
+
+typedef struct {
+    uint64_t empreinte;     // Haché de la clé utilisateur, jamais égal à VIDE ou SUPPRIME
+    uint64_t decalage;      // Position de la clé dans l'arène, suivie de la valeur
+    uint32_t taille_cle;
+    uint32_t taille_valeur;
+} Case;
+
+typedef struct {
+    Case *cases;
+    size_t capacite;        // Nombre de cases, puissance de 2
+    size_t nb_entrees;
+    size_t nb_supprimees;   // Cases SUPPRIME, comptées dans le taux de remplissage
+    char *arene;
+    size_t arene_utilise;
+    size_t arene_capacite;
+    size_t arene_perdu;     // Octets de l'arène occupés par des enregistrements morts
+} Stockage;
+
+static inline uint64_t stockage_empreinte(const void *cle, size_t taille_cle) {
+    uint64_t h = hash64(cle, taille_cle, UINT64_C(0x5a17));
+    return h > STOCKAGE_SUPPRIME ? h : h + 2;
+}
+
+static inline void stockage_init(Stockage *s) {
+    memset(s, 0, sizeof(Stockage));
+    s->capacite = 64;
+    s->cases = (Case *)calloc(s->capacite, sizeof(Case));
+}
+
+static inline void stockage_liberer(Stockage *s) {
+    free(s->cases);
+    free(s->arene);
+    memset(s, 0, sizeof(Stockage));
+}
+
+static inline const char *stockage_cle(const Stockage *s, const Case *c) {
+    return s->arene + c->decalage;
+}
+
+static inline const char *stockage_valeur(const Stockage *s, const Case *c) {
+    return s->arene + c->decalage + c->taille_cle;
+}
+
+// Indice de la case contenant la clé, -1 si elle est absente
+static inline long stockage_chercher(const Stockage *s, const void *cle, size_t taille_cle, uint64_t empreinte) {
+    size_t masque = s->capacite - 1;
+    for (size_t i = empreinte & masque; ; i = (i + 1) & masque) {
+        const Case *c = &s->cases[i];
+        if (c->empreinte == STOCKAGE_VIDE) return -1;
+        if (c->empreinte == empreinte && c->taille_cle == taille_cle
+            && memcmp(stockage_cle(s, c), cle, taille_cle) == 0) {
+            return (long)i;
+        }
+    }
+}
+
+// Recopie les enregistrements vivants au début d'une nouvelle arène
+static inline void stockage_compacter(Stockage *s) {
+    size_t capacite = s->arene_utilise - s->arene_perdu;
+    if (capacite < 4096) capacite = 4096;
+    char *arene = (char *)malloc(capacite);
+    size_t utilise = 0;
+    for (size_t i = 0; i < s->capacite; i++) {
+        Case *c = &s->cases[i];
+        if (c->empreinte <= STOCKAGE_SUPPRIME) continue;
+        size_t taille = (size_t)c->taille_cle + c->taille_valeur;
+        memcpy(arene + utilise, s->arene + c->decalage, taille);
+        c->decalage = utilise;
+        utilise += taille;
+    }
+    free(s->arene);
+    s->arene = arene;
+    s->arene_utilise = utilise;
+    s->arene_capacite = capacite;
+    s->arene_perdu = 0;
+}
+
+// Réserve taille octets à la fin de l'arène et retourne leur décalage
+// Quand les trous dépassent la moitié de l'arène on compacte au lieu d'agrandir
+static inline uint64_t stockage_reserver(Stockage *s, size_t taille) {
+    if (s->arene_utilise + taille > s->arene_capacite) {
+        if (s->arene_perdu > s->arene_utilise / 2) {
+            stockage_compacter(s);
+        }
+        if (s->arene_utilise + taille > s->arene_capacite) {
+            size_t capacite = s->arene_capacite ? 2 * s->arene_capacite : 4096;
+            while (s->arene_utilise + taille > capacite) capacite *= 2;
+            s->arene = (char *)realloc(s->arene, capacite);
+            s->arene_capacite = capacite;
+        }
+    }
+    uint64_t decalage = s->arene_utilise;
+    s->arene_utilise += taille;
+    return decalage;
+}
+
+// Double le nombre de cases et réinsère les entrées, les cases SUPPRIME disparaissent
+static inline void stockage_agrandir(Stockage *s) {
+    Case *anciennes = s->cases;
+    size_t ancienne_capacite = s->capacite;
+    if (s->nb_entrees + 1 > s->capacite / 4) s->capacite *= 2;
+    s->cases = (Case *)calloc(s->capacite, sizeof(Case));
+    size_t masque = s->capacite - 1;
+    for (size_t i = 0; i < ancienne_capacite; i++) {
+        if (anciennes[i].empreinte <= STOCKAGE_SUPPRIME) continue;
+        size_t j = anciennes[i].empreinte & masque;
+        while (s->cases[j].empreinte != STOCKAGE_VIDE) j = (j + 1) & masque;
+        s->cases[j] = anciennes[i];
+    }
+    s->nb_supprimees = 0;
+    free(anciennes);
+}
+
+// Ajoute ou remplace la valeur associée à la clé
+static inline void stockage_put(Stockage *s, const void *cle, size_t taille_cle, const void *valeur, size_t taille_valeur) {
+    uint64_t empreinte = stockage_empreinte(cle, taille_cle);
+    long i = stockage_chercher(s, cle, taille_cle, empreinte);
+    if (i >= 0) {
+        // L'ancien enregistrement devient un trou de l'arène une fois le nouveau réservé,
+        // un compactage pendant la réservation le déplace encore avec la case
+        uint64_t decalage = stockage_reserver(s, taille_cle + taille_valeur);
+        Case *c = &s->cases[i];
+        s->arene_perdu += (size_t)c->taille_cle + c->taille_valeur;
+        c->decalage = decalage;
+        c->taille_valeur = (uint32_t)taille_valeur;
+        memcpy(s->arene + c->decalage, cle, taille_cle);
+        memcpy(s->arene + c->decalage + taille_cle, valeur, taille_valeur);
+        return;
+    }
+
+    // Taux de remplissage maximal de 70 %, cases supprimées comprises
+    if (10 * (s->nb_entrees + s->nb_supprimees + 1) > 7 * s->capacite) {
+        stockage_agrandir(s);
+    }
+    size_t masque = s->capacite - 1;
+    size_t j = empreinte & masque;
+    while (s->cases[j].empreinte > STOCKAGE_SUPPRIME) j = (j + 1) & masque;
+    if (s->cases[j].empreinte == STOCKAGE_SUPPRIME) s->nb_supprimees--;
+
+    // La réservation peut compacter l'arène, la case n'est remplie qu'après
+    uint64_t decalage = stockage_reserver(s, taille_cle + taille_valeur);
+    Case *c = &s->cases[j];
+    c->empreinte = empreinte;
+    c->decalage = decalage;
+    c->taille_cle = (uint32_t)taille_cle;
+    c->taille_valeur = (uint32_t)taille_valeur;
+    memcpy(s->arene + decalage, cle, taille_cle);
+    memcpy(s->arene + decalage + taille_cle, valeur, taille_valeur);
+    s->nb_entrees++;
+}
+
+// Retourne la valeur associée à la clé, NULL si elle est absente
+// Le pointeur reste valide jusqu'à la prochaine modification de la table
+static inline const char *stockage_get(const Stockage *s, const void *cle, size_t taille_cle, size_t *taille_valeur) {
+    long i = stockage_chercher(s, cle, taille_cle, stockage_empreinte(cle, taille_cle));
+    if (i < 0) return NULL;
+    *taille_valeur = s->cases[i].taille_valeur;
+    return stockage_valeur(s, &s->cases[i]);
+}
+
+// Supprime la clé, retourne 1 si elle était présente
+static inline int stockage_del(Stockage *s, const void *cle, size_t taille_cle) {
+    long i = stockage_chercher(s, cle, taille_cle, stockage_empreinte(cle, taille_cle));
+    if (i < 0) return 0;
+    Case *c = &s->cases[i];
+    s->arene_perdu += (size_t)c->taille_cle + c->taille_valeur;
+    c->empreinte = STOCKAGE_SUPPRIME;
+    s->nb_entrees--;
+    s->nb_supprimees++;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// Traces par niveau, activées à la compilation avec -DTRACE_NIVEAU=<niveau>
+// Sans cette option les appels à TRACE ne produisent aucun code
+// Une fois activées, les traces sont écrites dans un tampon circulaire propre au processus
+// puis vidées dans trace_<rang>.log à la fin de l'exécution : le chemin de routage
+// ne se bloque jamais sur la sortie standard
+
+#define TRACE_ERREUR 1
+#define TRACE_INFO 2
+#define TRACE_DEBUG 3
+
+#ifndef TRACE_NIVEAU
+#define TRACE_NIVEAU 0
+#endif
+
+// Taille du tampon circulaire, les traces les plus anciennes sont écrasées
+#ifndef TRACE_TAILLE
+#define TRACE_TAILLE (1 << 20)
+#endif
+
+#define TRACE(niveau, ...) do { \
+        if ((niveau) <= TRACE_NIVEAU) trace_ecrire(__VA_ARGS__); \
+    } while (0)
+
+#if TRACE_NIVEAU > 0
+
+#include <mpi.h>
+
+typedef struct {
+    char tampon[TRACE_TAILLE];
+    size_t position;    // Prochaine position d'écriture
+    int plein;          // Indique si le tampon a déjà fait un tour
+    int rang;
+    int verrou;         // Les threads d'un processus écrivent chacun leur ligne en entier
+} Trace;
+
+static Trace trace;
+
+static inline void trace_init(int rang) {
+    trace.position = 0;
+    trace.plein = 0;
+    trace.rang = rang;
+}
+
+__attribute__((format(printf, 1, 2)))
+static inline void trace_ecrire(const char *format, ...) {
+    char ligne[512];
+    int n = snprintf(ligne, sizeof(ligne), "[%.6f] ", MPI_Wtime());
+    va_list args;
+    va_start(args, format);
+    n += vsnprintf(ligne + n, sizeof(ligne) - n, format, args);
+    va_end(args);
+    if (n >= (int)sizeof(ligne)) n = sizeof(ligne) - 1;
+
+    while (__atomic_test_and_set(&trace.verrou, __ATOMIC_ACQUIRE)) {
+    }
+    for (int i = 0; i < n; i++) {
+        trace.tampon[trace.position++] = ligne[i];
+        if (trace.position == TRACE_TAILLE) {
+            trace.position = 0;
+            trace.plein = 1;
+        }
+    }
+    __atomic_clear(&trace.verrou, __ATOMIC_RELEASE);
+}
+
+// Ecrit le contenu du tampon dans trace_<rang>.log, dans l'ordre chronologique
+static inline void trace_vider(void) {
+    char nom[64];
+    snprintf(nom, sizeof(nom), "trace_%d.log", trace.rang);
+    FILE *f = fopen(nom, "w");
+    if (f == NULL) return;
+
+    if (trace.plein) {
+        // La première ligne a pu être écrasée en partie, on repart de la ligne suivante
+        size_t debut = trace.position;
+        while (debut < TRACE_TAILLE && trace.tampon[debut] != '\n') debut++;
+        if (debut < TRACE_TAILLE) {
+            fwrite(trace.tampon + debut + 1, 1, TRACE_TAILLE - debut - 1, f);
+        }
+    }
+    fwrite(trace.tampon, 1, trace.position, f);
+    fclose(f);
+}
+
+#else
+
+static inline void trace_init(int rang) {
+    (void)rang;
+}
+
+__attribute__((format(printf, 1, 2)))
+static inline void trace_ecrire(const char *format, ...) {
+    (void)format;
+}
+
+static inline void trace_vider(void) {
+}
+
+#endif
+
+#endif